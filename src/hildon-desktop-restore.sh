@@ -46,4 +46,9 @@ if [ -d $HOME/.cache/launch ]; then
         rm -rf $HOME/.cache/launch/*
 fi
 
+# remove pre-scaled icons
+if [ -d $HOME/.cache/hildon-desktop/icons ]; then
+        rm -rf $HOME/.cache/hildon-desktop/icons/*
+fi
+
 kill `pidof hildon-home`
@@ -29,6 +29,7 @@
 #include "hd-comp-mgr.h"
 #include "hd-render-manager.h"
 #include "hd-transition.h"
+#include "hd-util.h"
 
 #include <glib/gstdio.h>
 
@@ -48,6 +49,10 @@
 
 #define BACKGROUNDS_DIR ".backgrounds"
 
+/* How much texture memory may the wallpapers take
+ * if transitions.ini doesn't say otherwise. */
+#define BACKGROUND_MEMORY_DEFAULT_KB 6144
+
 struct _HdHomeViewContainerPrivate
 {
   ClutterActor *views[MAX_HOME_VIEWS];
@@ -74,6 +79,8 @@ struct _HdHomeViewContainerPrivate
   gboolean animation_overshoot;
 
   gboolean in_move;
+  /* Whether the views are drawn from snapshots because we're panning. */
+  gboolean snapshots;
 
   /* GConf */
   GConfClient *gconf_client;
@@ -115,6 +122,81 @@ hd_home_view_container_update_previous_and_next_view (HdHomeViewContainer *self)
   priv->next_view = next_view;
 }
 
+/* Returns how many views @a is from @b, going around either way. */
+static guint
+view_distance (guint a, guint b)
+{
+  guint d = a > b ? a - b : b - a;
+
+  return MIN (d, MAX_HOME_VIEWS - d);
+}
+
+/*
+ * Loads the wallpapers of the current view and the ones next to it,
+ * which can be panned to any time, and if the wallpapers take more
+ * memory than home.background_memory_kb, frees the ones of inactive
+ * views, then of the farthest from the current.  Those are loaded
+ * again when they come near.
+ */
+static void
+hd_home_view_container_update_backgrounds (HdHomeViewContainer *self)
+{
+  HdHomeViewContainerPrivate *priv = self->priv;
+  guint near[3], i, j, dist;
+  gsize budget, total;
+
+  near[0] = priv->current_view;
+  near[1] = priv->previous_view;
+  near[2] = priv->next_view;
+  for (i = 0; i < G_N_ELEMENTS (near); i++)
+    {
+      HdHomeView *view = HD_HOME_VIEW (priv->views[near[i]]);
+
+      if (priv->active_views[near[i]] && !hd_home_view_has_background (view))
+        hd_home_view_load_background (view);
+    }
+
+  budget = 1024 * hd_transition_get_int ("home", "background_memory_kb",
+                                         BACKGROUND_MEMORY_DEFAULT_KB);
+  total = 0;
+  for (i = 0; i < MAX_HOME_VIEWS; i++)
+    total += hd_home_view_get_background_size (HD_HOME_VIEW (priv->views[i]));
+  if (total <= budget)
+    return;
+
+  /* First drop the wallpapers saved for the other orientation,
+   * except the current view's, which rotating would need at once. */
+  for (i = 0; i < MAX_HOME_VIEWS && total > budget; i++)
+    if (i != priv->current_view)
+      {
+        HdHomeView *view = HD_HOME_VIEW (priv->views[i]);
+
+        total -= hd_home_view_get_background_size (view);
+        hd_home_view_unload_background (view, TRUE);
+        total += hd_home_view_get_background_size (view);
+      }
+
+  /* Inactive views count as the farthest. */
+  for (dist = MAX_HOME_VIEWS; dist > 1 && total > budget; dist--)
+    for (i = 0; i < MAX_HOME_VIEWS && total > budget; i++)
+      {
+        HdHomeView *view = HD_HOME_VIEW (priv->views[i]);
+
+        for (j = 0; j < G_N_ELEMENTS (near); j++)
+          if (near[j] == i)
+            break;
+        if (j < G_N_ELEMENTS (near))
+          continue;
+        if ((priv->active_views[i]
+             ? view_distance (i, priv->current_view) : MAX_HOME_VIEWS) != dist)
+          continue;
+
+        total -= hd_home_view_get_background_size (view);
+        hd_home_view_unload_background (view, FALSE);
+        total += hd_home_view_get_background_size (view);
+      }
+}
+
 static void
 backgrounds_dir_changed (GFileMonitor        *monitor,
 			 GFile               *file,
@@ -147,7 +229,8 @@ backgrounds_dir_changed (GFileMonitor        *monitor,
 
           id = atoi (basename + 11) - 1; /* id is from 0..MAX_HOME_VIEWS - 1 */
 
-          if (id < MAX_HOME_VIEWS && priv->active_views[id])
+          if (id < MAX_HOME_VIEWS && priv->active_views[id]
+              && hd_home_view_has_background (HD_HOME_VIEW (priv->views[id])))
             {
               g_debug ("%s. Reload background %s for view %u.", __FUNCTION__,
                        info_uri, id + 1);
@@ -162,7 +245,8 @@ backgrounds_dir_changed (GFileMonitor        *monitor,
 
           id = atoi (basename + 20) - 1; /* id is from 0..MAX_HOME_VIEWS - 1 */
 
-          if (id < MAX_HOME_VIEWS && priv->active_views[id])
+          if (id < MAX_HOME_VIEWS && priv->active_views[id]
+              && hd_home_view_has_background (HD_HOME_VIEW (priv->views[id])))
             {
               g_debug ("%s. Reload background %s for view %u.", __FUNCTION__,
                        info_uri, id + 1);
@@ -273,11 +357,8 @@ hd_home_view_container_update_active_views (HdHomeViewContainer *self,
             clutter_actor_hide (priv->views[i]);
         }
 
+      /* This loads the backgrounds we need now. */
       hd_home_view_container_set_current_view (self, current_view);
-
-      /* Load backgrounds for active views */
-      for (i = 0; i < MAX_HOME_VIEWS; i++)
-        hd_home_view_load_background (HD_HOME_VIEW (priv->views[i]));
     }
   else
     {
@@ -285,7 +366,6 @@ hd_home_view_container_update_active_views (HdHomeViewContainer *self,
         {
           if (active_views[i] && !priv->active_views[i])
             {
-              hd_home_view_load_background (HD_HOME_VIEW (priv->views[i]));
               priv->active_views[i] = active_views[i];
               clutter_actor_show (priv->views[i]);
               g_object_notify (G_OBJECT (priv->views[i]), "active");
@@ -311,6 +391,9 @@ hd_home_view_container_update_active_views (HdHomeViewContainer *self,
       else
         {
           hd_home_view_container_update_previous_and_next_view (self);
+          hd_home_view_container_update_backgrounds (self);
+          for (i = 0; i < MAX_HOME_VIEWS; i++)
+            hd_home_view_update_state (HD_HOME_VIEW (priv->views[i]));
         }
     }
 }
@@ -360,6 +443,11 @@ hd_home_view_container_set_live_bg (HdHomeViewContainer *container,
   ClutterActor *actor;
   MBWMCompMgrClutterClient *cclient;
 
+  /* It may have been paused as a live background of another view,
+   * hd_comp_mgr_update_applets_on_current_desktop_property() will
+   * pause it again if needed. */
+  hd_util_set_damage_tracked (client, TRUE);
+
   view = client->window->live_background;
   if (view > 0 && view <= MAX_HOME_VIEWS)
     {
@@ -388,8 +476,10 @@ hd_home_view_container_set_live_bg (HdHomeViewContainer *container,
           for (i = 0; i < MAX_HOME_VIEWS; ++i)
             {
               hhview = HD_HOME_VIEW (priv->views[i]);
-              hd_home_view_load_background (hhview);
+              if (hd_home_view_has_background (hhview))
+                hd_home_view_load_background (hhview);
             }
+          hd_home_view_container_update_backgrounds (container);
         }
       else
         for (i = 0; i < MAX_HOME_VIEWS; ++i)
@@ -401,9 +491,11 @@ hd_home_view_container_set_live_bg (HdHomeViewContainer *container,
               {
                 hd_home_view_set_live_bg (hhview, NULL, FALSE);
                 /* restore normal background */
-                hd_home_view_load_background (hhview);
+                if (hd_home_view_has_background (hhview))
+                  hd_home_view_load_background (hhview);
               }
           }
+      hd_home_view_container_update_backgrounds (container);
     }
   else if (view == -1)
     {
@@ -455,9 +547,13 @@ hd_home_view_container_set_live_bg (HdHomeViewContainer *container,
       for (i = 0; i < MAX_HOME_VIEWS; ++i)
         {
           hhview = HD_HOME_VIEW (priv->views[i]);
-          hd_home_view_load_background (hhview);
+          if (hd_home_view_has_background (hhview))
+            hd_home_view_load_background (hhview);
         }
+      hd_home_view_container_update_backgrounds (container);
     }
+
+  hd_comp_mgr_update_applets_on_current_desktop_property (priv->comp_mgr);
 }
 
 static void
@@ -831,6 +927,7 @@ hd_home_view_container_set_current_view (HdHomeViewContainer *container,
   MBWindowManager *wm;
   long propvalue[1];
   GError *error = NULL;
+  guint i;
 
   g_return_if_fail (HD_IS_HOME_VIEW_CONTAINER (container));
   g_return_if_fail (current_view >= 0 && current_view < MAX_HOME_VIEWS);
@@ -877,6 +974,10 @@ hd_home_view_container_set_current_view (HdHomeViewContainer *container,
 		   (unsigned char *) propvalue,
 		   1);
 
+  hd_home_view_container_update_backgrounds (container);
+  for (i = 0; i < MAX_HOME_VIEWS; i++)
+    hd_home_view_update_state (HD_HOME_VIEW (priv->views[i]));
+
   clutter_actor_queue_relayout (CLUTTER_ACTOR (container));
 }
 
@@ -908,6 +1009,26 @@ hd_home_view_container_get_active (HdHomeViewContainer *container,
   return priv->active_views[view_id];
 }
 
+/* Switches the applets of the active views to snapshots at the start
+ * of a swipe and back to the live actors once it's settled, so that
+ * panning doesn't redraw every applet each frame.  Only the views
+ * actually painted take a snapshot. */
+static void
+hd_home_view_container_set_snapshots (HdHomeViewContainer *container,
+                                      gboolean             snapshots)
+{
+  HdHomeViewContainerPrivate *priv = container->priv;
+  guint i;
+
+  if (priv->snapshots == snapshots)
+    return;
+  priv->snapshots = snapshots;
+
+  for (i = 0; i < MAX_HOME_VIEWS; i++)
+    if (priv->active_views[i] || !snapshots)
+      hd_home_view_set_snapshot (HD_HOME_VIEW (priv->views[i]), snapshots);
+}
+
 void
 hd_home_view_container_set_offset (HdHomeViewContainer *container,
                                    gfloat               offset)
@@ -919,6 +1040,8 @@ hd_home_view_container_set_offset (HdHomeViewContainer *container,
   priv = container->priv;
 
   priv->offset = offset;
+  hd_home_view_container_set_snapshots (container,
+                                        offset || priv->timeline);
 
   clutter_actor_queue_relayout (CLUTTER_ACTOR (container));
 }
@@ -964,6 +1087,7 @@ scroll_back_completed_cb (ClutterTimeline     *timeline,
     }
 
   priv->in_move = FALSE;
+  hd_home_view_container_set_snapshots (container, FALSE);
 }
 
 /* Velocity is the speed in pixels/second, and we attempt to set the scroll
@@ -1020,6 +1144,7 @@ hd_home_view_container_scroll_back (HdHomeViewContainer *container, gint velocit
 
   g_debug ("duration: %u, offset: %d",
            priv->duration, priv->timeline_offset);
+  hd_home_view_container_set_snapshots (container, TRUE);
 
   g_signal_connect (priv->timeline, "new-frame",
                     G_CALLBACK (scroll_back_new_frame_cb), container);
@@ -35,9 +35,11 @@
 #include "hd-render-manager.h"
 #include "hd-clutter-cache.h"
 #include "hd-transition.h"
+#include "hd-icon-loader.h"
 
 #include "hildon-desktop.h"
 #include "../tidy/tidy-sub-texture.h"
+#include "../tidy/tidy-cached-group.h"
 
 #include <clutter/clutter.h>
 
@@ -46,6 +48,10 @@
 #include <glib/gstdio.h>
 #include <gconf/gconf-client.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
+#include <string.h>
+#ifdef __ARM_NEON__
+#include <arm_neon.h>
+#endif
 
 #define BACKGROUND_COLOR {0, 0, 0, 0xff}
 #define CACHED_BACKGROUND_IMAGE_FILE_PNG "%s/.backgrounds/background-%u.png"
@@ -65,6 +71,11 @@
 
 #define HD_HOME_VIEW_PARALLAX_AMOUNT (hd_transition_get_double("home", "parallax", 1.3))
 
+/* How many milliseconds to wait for more applets to be moved before
+ * writing their positions to GConf. */
+#define HD_HOME_VIEW_POSITION_FLUSH_DELAY \
+  (hd_transition_get_int("home", "position_flush_delay", 1500))
+
 enum
 {
   PROP_COMP_MGR = 1,
@@ -91,6 +102,12 @@ struct _HdHomeViewPrivate
   MBWindowManagerClient    *live_bg;
 
   GHashTable               *applets;
+  /* The #HdHomeViewAppletData:s of @applets in stacking order, which is
+   * the order of their modification time, the most recent last. */
+  GPtrArray                *stacking;
+  /* Whether the close and configure buttons of the applets are shown,
+   * so that they're only touched when entering or leaving edit mode. */
+  gboolean                  edit_chrome;
 
   gboolean                  is_portrait;
 
@@ -110,6 +127,10 @@ struct _HdHomeViewPrivate
   guint                     id;
 
   guint load_background_source;
+  /* The PNG wallpaper being decoded in the background. */
+  HdIconRequest *background_req;
+  /* Whether the wallpaper has been asked for and not unloaded since. */
+  gboolean background_requested;
 
   GConfClient *gconf_client;
 
@@ -169,6 +190,21 @@ struct _HdHomeViewAppletData
 static HdHomeViewAppletData *applet_data_new  (ClutterActor *actor);
 static void                  applet_data_free (HdHomeViewAppletData *data);
 
+/* An applet position not written to GConf yet. */
+typedef struct
+{
+  gint x, y;
+} PendingPosition;
+
+/* GConf position key -> #PendingPosition.  They are common to all views
+ * since applets can move between them.  @Flush_positions_cb writes them
+ * and syncs GConf once the applets have been left alone for a while. */
+static GHashTable *Pending_positions;
+static guint Flush_positions_cb;
+
+static void flush_positions (void);
+static void schedule_flush (void);
+
 G_DEFINE_TYPE (HdHomeView, hd_home_view, CLUTTER_TYPE_GROUP);
 
 static void
@@ -364,6 +400,7 @@ hd_home_view_constructed (GObject *object)
   priv->applets = g_hash_table_new_full (g_direct_hash, g_direct_equal,
                                          NULL,
                                          (GDestroyNotify) applet_data_free);
+  priv->stacking = g_ptr_array_new ();
 
   priv->background_container = clutter_group_new ();
   clutter_actor_set_name (priv->background_container, "HdHomeView::background-container");
@@ -379,8 +416,11 @@ hd_home_view_constructed (GObject *object)
                            priv->background_container);
   clutter_actor_add_child (CLUTTER_ACTOR (object), priv->background_container);
 
-  priv->applets_container = clutter_group_new ();
+  /* Cached while the views are panned, see hd_home_view_set_snapshot(). */
+  priv->applets_container = tidy_cached_group_new ();
   clutter_actor_set_name (priv->applets_container, "HdHomeView::applets-container");
+  tidy_cached_group_set_use_alpha (priv->applets_container, TRUE);
+  tidy_cached_group_set_downsampling_factor (priv->applets_container, 1);
 #ifdef UPSTREAM_DISABLED
   clutter_actor_set_visibility_detect(priv->applets_container, FALSE);
 #endif
@@ -444,10 +484,15 @@ hd_home_view_dispose (GObject *object)
   /* Remove idle/timeout handlers */
   if (priv->load_background_source)
     priv->load_background_source = (g_source_remove (priv->load_background_source), 0);
+  if (priv->background_req)
+    priv->background_req = (hd_icon_loader_cancel (priv->background_req), NULL);
 
+  flush_positions ();
   if (priv->gconf_client)
     priv->gconf_client = (g_object_unref (priv->gconf_client), NULL);
 
+  if (priv->stacking)
+    priv->stacking = (g_ptr_array_free (priv->stacking, TRUE), NULL);
   if (priv->applets)
     priv->applets = (g_hash_table_destroy (priv->applets), NULL);
 
@@ -463,6 +508,9 @@ hd_home_view_finalize (GObject *object)
   G_OBJECT_CLASS (hd_home_view_parent_class)->finalize (object);
 }
 
+static void show_background (HdHomeView *hview, ClutterActor *new_bg,
+                             TidySubTexture *new_bg_sub);
+
 static void
 set_background_common (HdHomeView *hview, ClutterActor *new_bg)
 {
@@ -535,6 +583,17 @@ set_background_common (HdHomeView *hview, ClutterActor *new_bg)
       && hd_home_is_portrait_wallpaper_enabled (priv->home))
       return;
 
+    show_background (hview, new_bg, new_bg_sub);
+}
+
+/* Replaces the shown background with @new_bg and @new_bg_sub,
+ * destroying the old ones. */
+static void
+show_background (HdHomeView *hview, ClutterActor *new_bg,
+                 TidySubTexture *new_bg_sub)
+{
+  HdHomeViewPrivate *priv = hview->priv;
+
     /* Add new background to the background container */
     clutter_actor_add_child (CLUTTER_ACTOR(priv->background_container), new_bg);
 
@@ -558,6 +617,197 @@ set_background_common (HdHomeView *hview, ClutterActor *new_bg)
     
 }
 
+/* A PNG wallpaper being loaded by the icon loader.  If it's dithered,
+ * decode_background() leaves the @rgb565 pixels of the @width x @height
+ * texture here, which only background_decoded() touches after it. */
+typedef struct
+{
+  HdHomeView *view;
+  gboolean is_portrait, dither;
+
+  guint16 *rgb565;
+  guint width, height;
+} BackgroundLoad;
+
+static void
+free_background_load (BackgroundLoad *load)
+{
+  g_free (load->rgb565);
+  g_slice_free (BackgroundLoad, load);
+}
+
+/* 4x4 ordered dither matrix. */
+static const guchar Bayer[4][4] =
+{
+  {  0,  8,  2, 10 },
+  { 12,  4, 14,  6 },
+  {  3, 11,  1,  9 },
+  { 15,  7, 13,  5 },
+};
+
+/*
+ * Dithers the @width pixels of the 8-bit RGB @src to RGB565 and packs
+ * them into @dst.  Red and blue lose 3 bits, green 2, so the matrix row
+ * of @y is scaled to the step of each before it's added.  The thresholds
+ * only depend on the column modulo 4, so the NEON version can do 16
+ * pixels at a time with the matrix row repeated across the lanes.
+ *
+ * There's no SSE2 version.  SSE2 can't deinterleave 24-bit pixels
+ * without a byte shuffle, and x86 builds are only for development.
+ */
+static void
+dither_row_rgb565 (guint16 *dst, const guchar *src, guint width, guint y)
+{
+  guchar add[4][3];
+  guint x;
+
+  for (x = 0; x < 4; x++)
+    {
+      add[x][0] = add[x][2] = Bayer[y & 3][x] >> 1;
+      add[x][1] = Bayer[y & 3][x] >> 2;
+    }
+
+  x = 0;
+#ifdef __ARM_NEON__
+  {
+    guchar rb[16], g[16];
+    uint8x16_t addrb, addg;
+
+    for (x = 0; x < 16; x++)
+      {
+        rb[x] = add[x & 3][0];
+        g[x]  = add[x & 3][1];
+      }
+    addrb = vld1q_u8 (rb);
+    addg  = vld1q_u8 (g);
+
+    for (x = 0; x + 16 <= width; x += 16, src += 3*16, dst += 16)
+      {
+        uint8x16x3_t rgb;
+        uint16x8_t lo, hi;
+
+        rgb = vld3q_u8 (src);
+        rgb.val[0] = vqaddq_u8 (rgb.val[0], addrb);
+        rgb.val[1] = vqaddq_u8 (rgb.val[1], addg);
+        rgb.val[2] = vqaddq_u8 (rgb.val[2], addrb);
+
+        /* Move each channel to the top of 16 bits then shift the next
+         * one in under it, keeping the 5, 6 and 5 bits we need. */
+        lo = vshll_n_u8 (vget_low_u8 (rgb.val[0]), 8);
+        lo = vsriq_n_u16 (lo, vshll_n_u8 (vget_low_u8 (rgb.val[1]), 8), 5);
+        lo = vsriq_n_u16 (lo, vshll_n_u8 (vget_low_u8 (rgb.val[2]), 8), 11);
+        hi = vshll_n_u8 (vget_high_u8 (rgb.val[0]), 8);
+        hi = vsriq_n_u16 (hi, vshll_n_u8 (vget_high_u8 (rgb.val[1]), 8), 5);
+        hi = vsriq_n_u16 (hi, vshll_n_u8 (vget_high_u8 (rgb.val[2]), 8), 11);
+        vst1q_u16 (dst,     lo);
+        vst1q_u16 (dst + 8, hi);
+      }
+  }
+#endif
+
+  for (; x < width; x++, src += 3, dst++)
+    {
+      guint r, g, b;
+
+      r = MIN (src[0] + add[x & 3][0], 0xFF);
+      g = MIN (src[1] + add[x & 3][1], 0xFF);
+      b = MIN (src[2] + add[x & 3][2], 0xFF);
+      *dst = (r >> 3) << 11 | (g >> 2) << 5 | b >> 3;
+    }
+}
+
+/* Dithers @pixbuf to RGB565 into @load->rgb565 if it's 8-bit RGB. */
+static void
+dither_rgb565 (BackgroundLoad *load, GdkPixbuf *pixbuf)
+{
+  guint y, width, height, rowstride;
+  const guchar *row;
+  guint16 *dst;
+
+  if (gdk_pixbuf_get_bits_per_sample (pixbuf) != 8
+      || gdk_pixbuf_get_n_channels (pixbuf) != 3)
+    return;
+  width     = gdk_pixbuf_get_width (pixbuf);
+  height    = gdk_pixbuf_get_height (pixbuf);
+  rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+  if (!(dst = g_try_new (guint16, width * height)))
+    return;
+
+  load->rgb565 = dst;
+  load->width  = width;
+  load->height = height;
+  row = gdk_pixbuf_get_pixels (pixbuf);
+  for (y = 0; y < height; y++, row += rowstride, dst += width)
+    dither_row_rgb565 (dst, row, width, y);
+}
+
+/* Called in the loader's worker thread. */
+static GdkPixbuf *
+decode_background (const gchar *fname, gpointer data)
+{
+  BackgroundLoad *load = data;
+  GdkPixbuf *pixbuf;
+  GError *error = NULL;
+
+  if (!(pixbuf = gdk_pixbuf_new_from_file (fname, &error)))
+    {
+      g_warning ("Error loading cached background image %s. %s",
+                 fname, error ? error->message : "");
+      if (error)
+        g_error_free (error);
+      return NULL;
+    }
+
+  if (load->dither && !gdk_pixbuf_get_has_alpha (pixbuf))
+    dither_rgb565 (load, pixbuf);
+  return pixbuf;
+}
+
+/* Back in the main thread, turns the decoded wallpaper into a texture
+ * and shows it, or saves it for the orientation it's for.  Dithered
+ * ones are uploaded as the RGB565 they were packed to. */
+static void
+background_decoded (GdkPixbuf *pixbuf, gpointer data)
+{
+  BackgroundLoad *load = data;
+  HdHomeViewPrivate *priv = load->view->priv;
+  ClutterActor *new_bg;
+
+  priv->background_req = NULL;
+
+  /* Show black if it couldn't be loaded, like the PVR path does. */
+  new_bg = NULL;
+  if (pixbuf && load->rgb565)
+    {
+      CoglHandle tex;
+
+      tex = cogl_texture_new_from_data (load->width, load->height,
+                                        COGL_TEXTURE_NONE,
+                                        COGL_PIXEL_FORMAT_RGB_565,
+                                        COGL_PIXEL_FORMAT_RGB_565,
+                                        load->width * sizeof (guint16),
+                                        (const guint8 *)load->rgb565);
+      load->rgb565 = (g_free (load->rgb565), NULL);
+      if (tex != COGL_INVALID_HANDLE)
+        {
+          new_bg = clutter_texture_new ();
+          clutter_texture_set_cogl_texture (CLUTTER_TEXTURE (new_bg), tex);
+          cogl_handle_unref (tex);
+        }
+    }
+  else if (pixbuf)
+    {
+      new_bg = clutter_texture_new ();
+      if (!hd_icon_loader_pixbuf_to_texture (CLUTTER_TEXTURE (new_bg),
+                                             pixbuf, FALSE))
+        new_bg = (clutter_actor_destroy (new_bg), NULL);
+    }
+
+  priv->is_portrait = load->is_portrait;
+  set_background_common (load->view, new_bg);
+  priv->is_portrait = FALSE;
+}
+
 static gboolean
 load_background_idle (gpointer data)
 {
@@ -567,6 +817,7 @@ load_background_idle (gpointer data)
   ClutterActor *new_bg = 0;
   GError *error = NULL;
   GError *error_portrait = NULL;
+  gboolean portrait;
   int i;
   int max_value;
 
@@ -578,7 +829,13 @@ load_background_idle (gpointer data)
   else
     max_value = 1;
 
+  portrait = hd_comp_mgr_is_portrait ();
   for(i = 0; i < max_value; i++){
+    /* The wallpaper of the other orientation is only loaded
+     * by hd_home_view_change_wallpaper() when we're rotated. */
+    if (max_value > 1 && (i ? !portrait : portrait))
+      continue;
+
     if(!i)
       {
         cached_background_image_file = g_strdup_printf (CACHED_BACKGROUND_IMAGE_FILE_PNG,
@@ -618,90 +875,22 @@ load_background_idle (gpointer data)
           }
       }
     else
-      {
-#if defined(MAEMO_CHANGES) && defined(UPSTREAM_DISABLED)
-        GdkPixbuf        *pixbuf;
-
-        /* Load image directly. We actually want to dither it on the fly to
-         * 16 bit, and clutter doesn't do this for us so we implement a very
-         * quick dither here. */
-        if(!i) 
-          pixbuf = gdk_pixbuf_new_from_file (cached_background_image_file, &error);
-        else
-          pixbuf = gdk_pixbuf_new_from_file (cached_background_image_file, &error_portrait);
-          
-        if (pixbuf != NULL)
-          {
-            gboolean          has_alpha;
-            gint              width;
-            gint              height;
-            gint              rowstride;
-            gint              n_channels;
-            guchar           *pixels;
-            gushort          *out_pixels, *out;
-            guint             lfsr = 1;
-            gint x,y;
-
-            /* Get pixbuf properties */
-            has_alpha       = gdk_pixbuf_get_has_alpha (pixbuf);
-            width           = gdk_pixbuf_get_width (pixbuf);
-            height          = gdk_pixbuf_get_height (pixbuf);
-            rowstride       = gdk_pixbuf_get_rowstride (pixbuf);
-            n_channels      = gdk_pixbuf_get_n_channels (pixbuf);
-            pixels          = gdk_pixbuf_get_pixels (pixbuf);
-
-            if (gdk_pixbuf_get_bits_per_sample (pixbuf)==8 &&
-                (n_channels==3 || n_channels==4))
-              {
-                out_pixels = g_malloc(width*height*2);
-                out = out_pixels;
-                for (y=0;y<height;y++) {
-                  for (x=0;x<width;x++) {
-                    /* http://en.wikipedia.org/wiki/Linear_feedback_shift_register */
-                    lfsr = (lfsr >> 1) ^ (unsigned int)((0 - (lfsr & 1u)) & 0xd0000001u);
-  
-                    /* dither 565 - by adding random noise and then truncating
-                     * (r>>8)*0xFF makes sure our bottom 8 bits are 0xFF if we
-                     * overflow.
-                     */
-                    guint r,g,b;
-                    r = pixels[0] + (lfsr&7);
-                    r |= (r>>8)*0xFF;
-                    g = pixels[1] + ((lfsr>>3)&3);
-                    g |= (g>>8)*0xFF;
-                    b = pixels[2] + ((lfsr>>5)&7);
-                    b |= (b>>8)*0xFF;
-                    *out = ((r<<8)&0xF800) |
-                           ((g<<3)&0x07E0) |
-                           ((b>>3)&0x001F);
-
-                    pixels += n_channels;
-                    out++;
-                  }
-                  pixels += rowstride - width*n_channels;
-                }
-                new_bg = clutter_texture_new();
-
-                if(!i) 
-                  {
-                    clutter_texture_set_from_rgb_data(CLUTTER_TEXTURE(new_bg),
-                          (guchar*)out_pixels, FALSE,
-                          width, height, width*2, 2, CLUTTER_TEXTURE_NONE, &error);
-                  }
-                else 
-                  {
-                    clutter_texture_set_from_rgb_data(CLUTTER_TEXTURE(new_bg),
-                          (guchar*)out_pixels, FALSE,
-                          width, height, width*2, 2, CLUTTER_TEXTURE_NONE, &error_portrait);
-                  }
-
-                g_free(out_pixels);
-              }
-            g_object_unref (pixbuf);
-          }
-#else
-      new_bg = clutter_texture_new_from_file (cached_background_image_file, &error);
-#endif
+      { /* Decode it in the background, see background_decoded(). */
+        BackgroundLoad *load;
+
+        load = g_slice_new0 (BackgroundLoad);
+        load->view = self;
+        load->is_portrait = priv->is_portrait;
+        load->dither = hd_transition_get_int ("home", "dither_wallpapers", 0);
+        if (priv->background_req)
+          hd_icon_loader_cancel (priv->background_req);
+        priv->background_req = hd_icon_loader_load_with (
+                                       cached_background_image_file,
+                                       decode_background, background_decoded,
+                                       load, (GDestroyNotify)free_background_load);
+        g_free (cached_background_image_file);
+        priv->load_background_source = 0;
+        continue;
       }
 
     if(!i) 
@@ -757,6 +946,8 @@ hd_home_view_set_live_bg (HdHomeView *view,
       g_source_remove (priv->load_background_source);
       priv->load_background_source = 0;
     }
+  if (priv->background_req && !above_applets)
+    priv->background_req = (hd_icon_loader_cancel (priv->background_req), NULL);
 
   if (client) 
     {
@@ -809,6 +1000,11 @@ hd_home_view_load_background (HdHomeView *view)
   g_return_if_fail (HD_IS_HOME_VIEW (view));
 
   priv = view->priv;
+  priv->background_requested = TRUE;
+  if (priv->load_background_source)
+    g_source_remove (priv->load_background_source);
+  if (priv->background_req)
+    priv->background_req = (hd_icon_loader_cancel (priv->background_req), NULL);
 
   /* Check current home view and increase priority if this is the current one */
   if (hd_home_view_container_get_current_view (priv->view_container) == priv->id)
@@ -820,6 +1016,117 @@ hd_home_view_load_background (HdHomeView *view)
                                                   NULL);
 }
 
+/* While @snapshot the applets of @view are drawn from an image taken
+ * when this is called, so that panning the view only moves that and
+ * the wallpaper.  The applets are drawn live again and the image is
+ * freed when it's turned off. */
+void
+hd_home_view_set_snapshot (HdHomeView *view, gboolean snapshot)
+{
+  HdHomeViewPrivate *priv;
+
+  g_return_if_fail (HD_IS_HOME_VIEW (view));
+  priv = view->priv;
+
+  /* Releasing also makes it take a new image of the right size. */
+  tidy_cached_group_release_cache (priv->applets_container);
+  tidy_cached_group_set_render_cache (priv->applets_container,
+                                      snapshot ? 1 : 0);
+}
+
+/* Whether the wallpaper of @view is loaded or being loaded, or it has
+ * a live background instead, so hd_home_view_load_background() needn't
+ * be called to show it. */
+gboolean
+hd_home_view_has_background (HdHomeView *view)
+{
+  HdHomeViewPrivate *priv = view->priv;
+
+  return priv->background_requested || priv->live_bg;
+}
+
+/* Returns roughly how much texture memory @bg takes.  Four bytes
+ * a pixel is counted, more than compressed wallpapers take. */
+static gsize
+background_size (ClutterActor *bg)
+{
+  gint width, height;
+
+  if (!bg || !CLUTTER_IS_TEXTURE (bg))
+    return 0;
+  clutter_texture_get_base_size (CLUTTER_TEXTURE (bg), &width, &height);
+  return 4 * width * height;
+}
+
+/* Returns how much texture memory the wallpapers of @view take,
+ * including the one saved for the other orientation. */
+gsize
+hd_home_view_get_background_size (HdHomeView *view)
+{
+  HdHomeViewPrivate *priv = view->priv;
+  gsize size;
+
+  size = background_size (priv->background_temp)
+    + background_size (priv->background_temp_portrait);
+  if (!priv->live_bg && priv->background != priv->background_temp
+      && priv->background != priv->background_temp_portrait)
+    size += background_size (priv->background);
+  return size;
+}
+
+/* Destroys the saved wallpaper @bg and @sub unless it is shown. */
+static void
+drop_saved_background (HdHomeViewPrivate *priv,
+                       ClutterActor **bg, TidySubTexture **sub)
+{
+  if (*bg == priv->background)
+    return;
+  if (*bg)
+    clutter_actor_destroy (*bg);
+  if (*sub)
+    clutter_actor_destroy (CLUTTER_ACTOR (*sub));
+  *bg = NULL;
+  *sub = NULL;
+}
+
+/* Frees the wallpaper saved for the other orientation of @view, and
+ * unless @keep_shown, the shown one too, which is replaced by black
+ * until hd_home_view_load_background().  Live backgrounds are kept. */
+void
+hd_home_view_unload_background (HdHomeView *view, gboolean keep_shown)
+{
+  HdHomeViewPrivate *priv;
+  ClutterColor clr = BACKGROUND_COLOR;
+  ClutterActor *black;
+
+  g_return_if_fail (HD_IS_HOME_VIEW (view));
+  priv = view->priv;
+
+  drop_saved_background (priv, &priv->background_temp,
+                         &priv->background_sub_temp);
+  drop_saved_background (priv, &priv->background_temp_portrait,
+                         &priv->background_sub_temp_portrait);
+  if (keep_shown || priv->live_bg)
+    return;
+
+  if (priv->load_background_source)
+    priv->load_background_source = (g_source_remove (priv->load_background_source), 0);
+  if (priv->background_req)
+    priv->background_req = (hd_icon_loader_cancel (priv->background_req), NULL);
+  priv->background_requested = FALSE;
+
+  /* The shown one is destroyed by show_background(). */
+  priv->background_temp = priv->background_temp_portrait = NULL;
+  priv->background_sub_temp = priv->background_sub_temp_portrait = NULL;
+
+  black = clutter_rectangle_new_with_color (&clr);
+  clutter_actor_set_name (black, "HdHomeView::background");
+  clutter_actor_set_size (black,
+                          HD_COMP_MGR_LANDSCAPE_WIDTH,
+                          HD_COMP_MGR_LANDSCAPE_HEIGHT);
+  show_background (view, black, NULL);
+}
+
 static void
 hd_home_view_set_property (GObject       *object,
 			   guint         prop_id,
@@ -1033,8 +1340,10 @@ hd_home_view_applet_press (ClutterActor       *applet,
   /* Raise the applet */
   clutter_actor_raise_top (applet);
 
-  /* Store the modifed time of the applet */
+  /* Store the modifed time of the applet, which makes it the topmost. */
   time (&wm_applet->modified);
+  g_ptr_array_remove (priv->stacking, data);
+  g_ptr_array_add (priv->stacking, data);
 
   modified = g_strdup_printf ("%ld", wm_applet->modified);
 
@@ -1054,15 +1363,7 @@ hd_home_view_applet_press (ClutterActor       *applet,
   g_free (modified);
   g_free (modified_key);
 
-  gconf_client_suggest_sync (priv->gconf_client,
-                             &error);
-  if (G_UNLIKELY (error))
-    {
-      g_warning ("%s. Could not sync GConf. %s",
-                 __FUNCTION__,
-                 error->message);
-      g_clear_error (&error);
-    }
+  schedule_flush ();
 
 
   mb_wm_client_stacking_mark_dirty (desktop_client);
@@ -1085,17 +1386,9 @@ hd_home_view_applet_press (ClutterActor       *applet,
 #define SNAP_GRID_SIZE_DEFAULT 4
 
 static gint
-snap_coordinate_to_grid (gint coordinate)
+snap_coordinate_to_grid (gint coordinate, gint snap_grid_size)
 {
-  gint snap_grid_size, offset;
- 
-  snap_grid_size  = hd_transition_get_int ("edit_mode",
-                                           "snap_grid_size",
-                                           SNAP_GRID_SIZE_DEFAULT);
-
-  /* Avoid hildon-desktop crash, when snap_grid_size == 0 */
-  if(snap_grid_size < 1)
-    snap_grid_size = SNAP_GRID_SIZE_DEFAULT;
+  gint offset;
 
   offset = coordinate % snap_grid_size;
 
@@ -1109,16 +1402,155 @@ static void
 snap_widget_to_grid (ClutterActor *widget)
 {
   ClutterGeometry c_geom;
+  gint snap_grid_size;
 
   /* Get applet size and position */
   clutter_actor_get_geometry (widget, &c_geom);
 
-  c_geom.x = snap_coordinate_to_grid (c_geom.x);
-  c_geom.y = snap_coordinate_to_grid (c_geom.y);
+  snap_grid_size  = hd_transition_get_int ("edit_mode",
+                                           "snap_grid_size",
+                                           SNAP_GRID_SIZE_DEFAULT);
+
+  /* Avoid hildon-desktop crash, when snap_grid_size == 0 */
+  if(snap_grid_size < 1)
+    snap_grid_size = SNAP_GRID_SIZE_DEFAULT;
+
+  c_geom.x = snap_coordinate_to_grid (c_geom.x, snap_grid_size);
+  c_geom.y = snap_coordinate_to_grid (c_geom.y, snap_grid_size);
 
   clutter_actor_set_position (widget, c_geom.x, c_geom.y);
 }
 
+static void
+free_pending_position (PendingPosition *pos)
+{
+  g_slice_free (PendingPosition, pos);
+}
+
+/* Writes the pending applet positions to GConf and syncs it. */
+static void
+flush_positions (void)
+{
+  GConfClient *gconf_client;
+  GHashTableIter iter;
+  gpointer key, value;
+  GError *error = NULL;
+
+  /* Nothing has been scheduled, nothing to write or sync. */
+  if (!Flush_positions_cb)
+    return;
+  Flush_positions_cb = (g_source_remove (Flush_positions_cb), 0);
+
+  gconf_client = gconf_client_get_default ();
+  g_hash_table_iter_init (&iter, Pending_positions);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      PendingPosition *pos = value;
+      GSList *position_value;
+
+      position_value = g_slist_prepend (g_slist_prepend (NULL,
+                                                         GINT_TO_POINTER (pos->y)),
+                                        GINT_TO_POINTER (pos->x));
+      gconf_client_set_list (gconf_client,
+                             key,
+                             GCONF_VALUE_INT,
+                             position_value,
+                             &error);
+      if (G_UNLIKELY (error))
+        {
+          g_warning ("Could not store applet position %s to GConf. %s",
+                     (const gchar *)key,
+                     error->message);
+          g_clear_error (&error);
+        }
+      g_slist_free (position_value);
+    }
+  g_hash_table_remove_all (Pending_positions);
+
+  gconf_client_suggest_sync (gconf_client,
+                             &error);
+  if (G_UNLIKELY (error))
+    {
+      g_warning ("%s. Could not sync GConf. %s",
+                 __FUNCTION__,
+                 error->message);
+      g_clear_error (&error);
+    }
+  g_object_unref (gconf_client);
+}
+
+static gboolean
+flush_positions_cb (gpointer unused)
+{
+  flush_positions ();
+  return FALSE;
+}
+
+/* (Re)starts the countdown of flush_positions(), even if there are
+ * no positions to write, just other GConf changes to sync. */
+static void
+schedule_flush (void)
+{
+  if (Flush_positions_cb)
+    g_source_remove (Flush_positions_cb);
+  Flush_positions_cb = g_timeout_add (HD_HOME_VIEW_POSITION_FLUSH_DELAY,
+                                      flush_positions_cb, NULL);
+}
+
+/* Remembers @x and @y for the GConf @position_key until they're
+ * written by flush_positions(). */
+static void
+store_position (const gchar *position_key, gint x, gint y)
+{
+  PendingPosition *pos;
+
+  if (!Pending_positions)
+    Pending_positions = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                      (GDestroyNotify)free_pending_position);
+
+  pos = g_slice_new (PendingPosition);
+  pos->x = x;
+  pos->y = y;
+  g_hash_table_insert (Pending_positions, g_strdup (position_key), pos);
+  schedule_flush ();
+}
+
+/* Returns the position of @position_key in GConf, or if it hasn't been
+ * written yet, the one waiting to be.  Like gconf_client_get_list(). */
+static GSList *
+load_position (GConfClient *gconf_client, const gchar *position_key)
+{
+  PendingPosition *pos;
+
+  if (Pending_positions
+      && (pos = g_hash_table_lookup (Pending_positions, position_key)))
+    return g_slist_prepend (g_slist_prepend (NULL, GINT_TO_POINTER (pos->y)),
+                            GINT_TO_POINTER (pos->x));
+
+  return gconf_client_get_list (gconf_client,
+                                position_key,
+                                GCONF_VALUE_INT,
+                                NULL);
+}
+
+/* Drops the positions of @applet_id not written yet, so they don't
+ * overwrite it being unset. */
+static void
+forget_positions (const gchar *applet_id)
+{
+  gchar *position_key;
+
+  if (!Pending_positions)
+    return;
+
+  position_key = g_strdup_printf (GCONF_KEY_POSITION, applet_id);
+  g_hash_table_remove (Pending_positions, position_key);
+  g_free (position_key);
+  position_key = g_strdup_printf (GCONF_KEY_POSITION_PORTRAIT, applet_id);
+  g_hash_table_remove (Pending_positions, position_key);
+  g_free (position_key);
+}
+
 static void
 hd_home_view_store_applet_position (HdHomeView   *view,
                                     ClutterActor *applet,
@@ -1174,8 +1606,6 @@ hd_home_view_store_applet_position (HdHomeView   *view,
     {
       const gchar *applet_id;
       gchar *position_key;
-      GSList *position_value;
-      GError *error = NULL;
 
       applet_id = HD_HOME_APPLET (data->cc->wm_client)->applet_id;
 
@@ -1188,34 +1618,10 @@ hd_home_view_store_applet_position (HdHomeView   *view,
 				position_key = g_strdup_printf (GCONF_KEY_POSITION_PORTRAIT, applet_id);
 			}
 
-      position_value = g_slist_prepend (g_slist_prepend (NULL,
-                                                         GINT_TO_POINTER (c_geom.y)),
-                                        GINT_TO_POINTER (c_geom.x));
-      gconf_client_set_list (priv->gconf_client,
-                             position_key,
-                             GCONF_VALUE_INT,
-                             position_value,
-                             &error);
-      if (G_UNLIKELY (error))
-        {
-          g_warning ("Could not store new applet position for applet %s to GConf. %s",
-                     applet_id,
-                     error->message);
-          g_clear_error (&error);
-        }
-
-      gconf_client_suggest_sync (priv->gconf_client,
-                                 &error);
-      if (G_UNLIKELY (error))
-        {
-          g_warning ("%s. Could not sync GConf. %s",
-                     __FUNCTION__,
-                     error->message);
-          g_clear_error (&error);
-        }
-
+      /* Rearranging applets would sync GConf for each of them,
+       * so it's left to flush_positions(). */
+      store_position (position_key, c_geom.x, c_geom.y);
       g_free (position_key);
-      g_slist_free (position_value);
     }
 }
 
@@ -1320,6 +1726,34 @@ cmp_applet_modified (gconstpointer a,
           - HD_HOME_APPLET (cc_b->wm_client)->modified;
 }
 
+/* Inserts @data into @priv->stacking where its modification time
+ * puts it, after the applets modified at the same time. */
+static void
+stack_applet (HdHomeView *view, HdHomeViewAppletData *data)
+{
+  GPtrArray *stacking = view->priv->stacking;
+  guint lo, hi;
+
+  lo = 0;
+  hi = stacking->len;
+  while (lo < hi)
+    {
+      guint mid = (lo + hi) / 2;
+
+      if (cmp_applet_modified (((HdHomeViewAppletData *)
+                                g_ptr_array_index (stacking, mid))->cc,
+                               data->cc) <= 0)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  g_ptr_array_add (stacking, NULL);
+  memmove (&stacking->pdata[lo + 1], &stacking->pdata[lo],
+           (stacking->len - 1 - lo) * sizeof (gpointer));
+  stacking->pdata[lo] = data;
+}
+
 /* Return the list of CompMgrClients of the applets this homeview
  * manages sorted by their last modification time.   It's up to you
  * to free the list. */
@@ -1328,36 +1762,31 @@ hd_home_view_get_all_applets (HdHomeView *view)
 {
   HdHomeViewPrivate *priv = view->priv;
   GSList *sorted;
-  GHashTableIter iter;
-  gpointer tmp;
+  guint i;
 
-  /* Get a list of all applets sorted by modified time */
+  /* @stacking is already sorted by modified time. */
   sorted = NULL;
-  g_hash_table_iter_init (&iter, priv->applets);
-  while (g_hash_table_iter_next (&iter, NULL, &tmp))
-  {
-    HdHomeViewAppletData *value = tmp;
-    sorted = g_slist_insert_sorted (sorted, value->cc, cmp_applet_modified);
-  }
+  for (i = priv->stacking->len; i > 0; i--)
+    {
+      HdHomeViewAppletData *value = g_ptr_array_index (priv->stacking, i - 1);
+      sorted = g_slist_prepend (sorted, value->cc);
+    }
   return sorted;
 }
 
 static void
 hd_home_view_restack_applets (HdHomeView *view)
 {
-  GSList *sorted = NULL, *s;
+  HdHomeViewPrivate *priv = view->priv;
+  guint i;
 
-  /* Get a list of all applets sorted by modified time
-   * and raise them in the order of the list. */
-  sorted = hd_home_view_get_all_applets (view);
-  for (s = sorted; s; s = s->next)
+  /* Raise the applets in the order they were last modified. */
+  for (i = 0; i < priv->stacking->len; i++)
     {
-      MBWMCompMgrClutterClient *cc = s->data;
-      ClutterActor *actor = mb_wm_comp_mgr_clutter_client_get_actor (cc);
+      HdHomeViewAppletData *data = g_ptr_array_index (priv->stacking, i);
 
-      clutter_actor_raise_top (actor);
+      clutter_actor_raise_top (data->actor);
     }
-  g_slist_free (sorted);
 }
 
 static void
@@ -1383,10 +1812,7 @@ hd_home_view_load_applet_position (HdHomeView           *view,
 		position_key = g_strdup_printf (GCONF_KEY_POSITION_PORTRAIT, applet_id);
 	}
 
-  position = gconf_client_get_list (priv->gconf_client,
-                                    position_key,
-                                    GCONF_VALUE_INT,
-                                    NULL);
+  position = load_position (priv->gconf_client, position_key);
 
   if (!force_arrange && position && position->next)
     {
@@ -1440,6 +1866,7 @@ close_applet (HdHomeView *view, HdHomeViewAppletData *data)
   /* Unset GConf configuration */
   applet_id = HD_HOME_APPLET (data->cc->wm_client)->applet_id;
 
+  forget_positions (applet_id);
   applet_key = g_strdup_printf ("/apps/osso/hildon-desktop/applets/%s", applet_id);
   gconf_client_recursive_unset (priv->gconf_client, applet_key, 0, NULL);
   g_free (applet_key);
@@ -1603,6 +2030,7 @@ hd_home_view_add_applet (HdHomeView   *view,
   g_hash_table_insert (priv->applets,
                        applet,
                        data);
+  stack_applet (view, data);
 
   hd_home_view_store_applet_position (view,
                                       applet,
@@ -1618,6 +2046,9 @@ hd_home_view_add_applet (HdHomeView   *view,
       mb_wm_sync (MB_WM_COMP_MGR (priv->comp_mgr)->wm);
     }
   hd_home_view_restack_applets (view);
+
+  hd_util_set_damage_tracked (data->cc->wm_client,
+                              hd_home_view_is_near (view));
 }
 
 void
@@ -1658,6 +2089,8 @@ hd_home_view_unregister_applet (HdHomeView *view, ClutterActor *applet)
 {
   HdHomeViewPrivate *priv = view->priv;
 
+  g_ptr_array_remove (priv->stacking,
+                     g_hash_table_lookup (priv->applets, applet));
   g_hash_table_remove (priv->applets, applet);
 
   hd_home_view_layout_reset (priv->layout);
@@ -1687,6 +2120,7 @@ hd_home_view_move_applet (HdHomeView   *view,
 	else
 		position_key = g_strdup_printf (GCONF_KEY_POSITION_PORTRAIT, wm_applet->applet_id);
 
+  forget_positions (wm_applet->applet_id);
   gconf_client_unset (priv->gconf_client, position_key, &error);
   if (G_UNLIKELY (error))
     {
@@ -1711,15 +2145,7 @@ hd_home_view_move_applet (HdHomeView   *view,
     }
   g_free (view_key);
 
-  gconf_client_suggest_sync (priv->gconf_client,
-                             &error);
-  if (G_UNLIKELY (error))
-    {
-      g_warning ("%s. Could not sync GConf. %s",
-                 __FUNCTION__,
-                 error->message);
-      g_clear_error (&error);
-    }
+  schedule_flush ();
 
   /* Unregister from old view */
   hd_home_view_unregister_applet (view, applet);
@@ -1768,24 +2194,58 @@ hd_home_view_close_all_applets (HdHomeView *view)
     }
  }
 
+/* Returns whether @view is the current one or can be panned to. */
+gboolean
+hd_home_view_is_near (HdHomeView *view)
+{
+  HdHomeViewContainer *container = view->priv->view_container;
+
+  return hd_home_view_container_get_current_view (container) == view->priv->id
+    || hd_home_view_container_get_previous_view (container)
+         == CLUTTER_ACTOR (view)
+    || hd_home_view_container_get_next_view (container)
+         == CLUTTER_ACTOR (view);
+}
+
 void
 hd_home_view_update_state (HdHomeView *view)
 {
   HdHomeViewPrivate *priv;
   GHashTableIter iter;
   gpointer value;
+  gboolean near, edit_chrome, update_chrome;
 
   g_return_if_fail (HD_IS_HOME_VIEW (view));
 
   priv = view->priv;
 
+  /* The applets of the views which can't be panned to can't be seen
+   * (they only get their _HILDON_APPLET_ON_CURRENT_DESKTOP taken away,
+   * which not all of them respect), so don't bother with what they
+   * draw either.  The neighbours of the current view are shown while
+   * panning, so they're kept up to date. */
+  near = hd_home_view_is_near (view);
+  edit_chrome = STATE_IN_EDIT_MODE (hd_render_manager_get_state ());
+
+  /* Done rearranging applets, write where they are. */
+  if (!edit_chrome)
+    flush_positions ();
+
+  /* Applets added meanwhile have got their buttons right already. */
+  update_chrome = edit_chrome != priv->edit_chrome;
+  priv->edit_chrome = edit_chrome;
+
   /* Iterate over all applets */
   g_hash_table_iter_init (&iter, priv->applets);
   while (g_hash_table_iter_next (&iter, NULL, &value))
     {
       HdHomeViewAppletData *data = value;
 
-      if (STATE_IN_EDIT_MODE (hd_render_manager_get_state ()))
+      hd_util_set_damage_tracked (data->cc->wm_client, near);
+
+      if (!update_chrome)
+        continue;
+      if (edit_chrome)
         {
           if (data->close_button)
             clutter_actor_show (data->close_button);
@@ -1937,10 +2397,8 @@ hd_home_view_change_wallpaper(HdHomeView *view)
   TidySubTexture *new_bg_sub = 0;
   ClutterActor *new_bg;
 
-  if(priv->background_temp_portrait == NULL ||
-      priv->background_temp == NULL)
-      return;
-
+  if (!hd_home_is_portrait_wallpaper_enabled (priv->home))
+    return;
 
   if(STATE_IS_PORTRAIT(hd_render_manager_get_state ()))
     {
@@ -1953,6 +2411,14 @@ hd_home_view_change_wallpaper(HdHomeView *view)
       new_bg_sub = priv->background_sub_temp;
     }
 
+  if (!new_bg)
+    { /* Not loaded for this orientation yet.  Views whose wallpaper
+       * was unloaded get it when they are about to be shown. */
+      if (priv->background_requested && !priv->live_bg)
+        hd_home_view_load_background (view);
+      return;
+    }
+
   clutter_actor_set_name (new_bg, "HdHomeView::background");
 
   g_object_ref(priv->background);
@@ -64,6 +64,7 @@ void hd_home_view_set_background_image (HdHomeView *view, const gchar * path);
 void hd_home_view_set_thumbnail_mode (HdHomeView * view, gboolean on);
 
 guint hd_home_view_get_view_id (HdHomeView *view);
+gboolean hd_home_view_is_near (HdHomeView *view);
 
 void hd_home_view_add_applet (HdHomeView   *view,
                               ClutterActor *applet,
@@ -87,6 +88,10 @@ void hd_home_view_set_live_bg (HdHomeView *view,
                                MBWindowManagerClient *client,
                                gboolean above_applets);
 void hd_home_view_load_background (HdHomeView *view);
+gboolean hd_home_view_has_background (HdHomeView *view);
+void hd_home_view_set_snapshot (HdHomeView *view, gboolean snapshot);
+gsize hd_home_view_get_background_size (HdHomeView *view);
+void hd_home_view_unload_background (HdHomeView *view, gboolean keep_shown);
 void hd_home_view_update_state (HdHomeView *view);
 
 void hd_home_view_change_applets_position (HdHomeView *view);
@@ -75,6 +75,8 @@
 #define PAN_NEXT_PREVIOUS_PERCENTAGE 0.25
 /* Time in secs to look back when finding average velocity */
 #define HDH_PAN_VELOCITY_HISTORY 0.125
+/* How many motion events to remember for that at most */
+#define HDH_PAN_DRAG_HISTORY 16
 
 #define HD_HOME_DBUS_NAME  "com.nokia.HildonDesktop.Home"
 #define HD_HOME_DBUS_PATH  "/com/nokia/HildonDesktop/Home"
@@ -123,6 +125,11 @@ typedef enum
   HD_HOME_GCONF_UPDATE_CALLUI
 } HdHomeGconfUpdateMode;
 
+typedef struct {
+  gint    delta;
+  gdouble period;
+} HdHomeDrag;
+
 struct _HdHomePrivate
 {
   MBWMCompMgrClutter    *comp_mgr;
@@ -136,6 +143,10 @@ struct _HdHomePrivate
 
   ClutterActor          *edge_indication_left;
   ClutterActor          *edge_indication_right;
+  /* Which orientation the edge indicators are laid out for,
+   * to do it only when it changes, not on every applet motion. */
+  gboolean               edge_indication_laid_out;
+  gboolean               edge_indication_portrait;
 
   ClutterActor          *view_container;
 
@@ -159,9 +170,16 @@ struct _HdHomePrivate
   gint                   velocity_x; /* movement in pixels per sec */
   gint                   velocity_y; /* movement in pixels per sec */
   GTimer                 *last_move_time; /* time of last movement event */
-  GList                  *drag_list;
-  /* List of HdHomeDrag - history of mouse events used to work out an
-   * average velocity */
+  /* Ring buffer of the last motion events, used to work out an average
+   * velocity.  @drag_head is where the next one goes. */
+  HdHomeDrag             drag_history[HDH_PAN_DRAG_HISTORY];
+  guint                  drag_head;
+  guint                  drag_count;
+  /* Whether the current pan is vertical, decided when it starts. */
+  gboolean               pan_vertical;
+  /* Applies the motion events of a frame at once, see
+   * hd_home_desktop_do_motion(). */
+  guint                  pan_motion_cb;
 
   gboolean               moved_over_threshold : 1;
   gboolean               long_press : 1;
@@ -202,12 +220,6 @@ struct _HdHomePrivate
   gchar *callui_interface[3];
 };
 
-typedef struct {
-  gint    x;
-  gint    y;
-  gdouble period;
-} HdHomeDrag;
-
 static void hd_home_class_init (HdHomeClass *klass);
 static void hd_home_init       (HdHome *self);
 static void hd_home_dispose    (GObject *object);
@@ -236,6 +248,7 @@ static gboolean do_home_applet_motion (HdHome       *home,
                                        ClutterActor *applet,
                                        int           x,
                                        int           y);
+static void layout_edge_indication (HdHome *home);
 static void update_edge_indication_visibility (HdHome *home,
                                                guint8  left_opacity,
                                                guint8  right_opacity);
@@ -340,24 +353,52 @@ hd_home_live_bg_emit_button1_event (
   XSendEvent(wm->xdpy, xev.window, True, 0, (XEvent *)&xev);
 }
 
-static void
-hd_home_desktop_do_motion (HdHome *home,
-                           int     x,
-                           int     y)
+/* Records a movement of @delta pixels along the pan and returns the
+ * average speed of the pan recently, in pixels per second. */
+static gint
+add_drag (HdHome *home, gint delta)
 {
-  HdHomePrivate   *priv = home->priv;
-  HdHomeDrag *drag_item;
+  HdHomePrivate *priv = home->priv;
+  HdHomeDrag *drag;
   gdouble time;
   gint drag_distance;
-  GList  *list;
+  guint i;
+
+  drag = &priv->drag_history[priv->drag_head];
+  drag->delta = delta;
+  drag->period = g_timer_elapsed (priv->last_move_time, NULL);
+  g_timer_reset (priv->last_move_time);
+  priv->drag_head = (priv->drag_head + 1) % HDH_PAN_DRAG_HISTORY;
+  if (priv->drag_count < HDH_PAN_DRAG_HISTORY)
+    priv->drag_count++;
+
+  DRAG_DEBUG("drag motion %dms -> %d", (int)(drag->period*1000), delta);
+
+  /* Average the movements of the last HDH_PAN_VELOCITY_HISTORY secs,
+   * but at least one before this one, even if it is too old. */
+  time = drag_distance = 0;
+  for (i = 0; i < priv->drag_count; i++)
+    {
+      drag = &priv->drag_history[(priv->drag_head + HDH_PAN_DRAG_HISTORY
+                                  - 1 - i) % HDH_PAN_DRAG_HISTORY];
+      if (i > 1 && time > HDH_PAN_VELOCITY_HISTORY)
+        break;
+      time += drag->period;
+      drag_distance += ABS (drag->delta);
+    }
+
+  return time > 0 ? drag_distance / time : 0;
+}
+
+/* Does the expensive part of following the pan for the motion events
+ * of a frame: tells the live background and moves the views. */
+static gboolean
+pan_motion_cb (HdHome *home)
+{
+  HdHomePrivate *priv = home->priv;
   MBWindowManagerClient *live_bg;
 
-  /* If the callback is 0, we're getting events after we got a do_release.
-   * This is because clutter has stored up the events, and we're called from
-   * hd_home_applet_motion instead. In this case just ignore, or we end up
-   * in the wrong position (bug 127320) */
-  if (!priv->desktop_motion_cb)
-    return;
+  priv->pan_motion_cb = 0;
 
   /* MotionNotify is forwarded to any live background */
   live_bg = hd_home_view_container_get_live_bg (
@@ -367,145 +408,91 @@ hd_home_desktop_do_motion (HdHome *home,
                                              hd_home_get_current_view (home)));
   if (live_bg)
     hd_home_live_bg_emit_button1_event (home, live_bg->window->xwindow,
-                                        x, y, MotionNotify);
+                                        priv->last_x, priv->last_y,
+                                        MotionNotify);
 
-  drag_item = g_malloc(sizeof(HdHomeDrag));
-  drag_item->period = g_timer_elapsed(priv->last_move_time, NULL);
-  g_timer_reset(priv->last_move_time);
+  if (priv->moved_over_threshold)
+    hd_home_view_container_set_offset (
+                          HD_HOME_VIEW_CONTAINER (priv->view_container),
+                          priv->pan_vertical ? priv->cumulative_y
+                                             : priv->cumulative_x);
 
-  if(!STATE_IS_PORTRAIT(hd_render_manager_get_state ())
-        || !priv->vertical_scrolling )
-    { /* Scrolling in landscape mode */
-      drag_item->x = x - priv->last_x;
-      priv->cumulative_x += drag_item->x;
+  return FALSE;
+}
 
-      DRAG_DEBUG("drag motion %dms, %dx%d -> %d", (int)(drag_item->period*1000),
-                 x, y, drag_item->x);
+/* Applies the pending motion at once, for the end of the pan. */
+static void
+flush_pan_motion (HdHome *home)
+{
+  HdHomePrivate *priv = home->priv;
 
-      /* Remove any items older than a certain age */
-      time = 0;
-      drag_distance = 0;
-      list = priv->drag_list;
-      while (list)
-        {
-          GList *next = list->next;
-          /* '&& next' ensures that we always average at least one previous
-           * movement event to get our velocity, even if it is too old. */
-          if (time > HDH_PAN_VELOCITY_HISTORY && next) {
-            g_free (list->data);
-            priv->drag_list = g_list_delete_link(priv->drag_list, list);
-          }
-          else
-            {
-              HdHomeDrag *drag = (HdHomeDrag*)list->data;
-              time += drag->period;
-              drag_distance += ABS(drag->x);
-            }
-          list = next;
-        }
-      /* Add new item to drag list */
-      priv->drag_list = g_list_prepend(priv->drag_list, drag_item);
-      /* Set velocity */
-      time += drag_item->period;
-      drag_distance += ABS(drag_item->x);
-      if (time > 0)
-        priv->velocity_x = drag_distance / time;
-      else
-        priv->velocity_x = 0;
-      if (priv->cumulative_x < 0)
-        priv->velocity_x = -priv->velocity_x;
+  if (priv->pan_motion_cb)
+    {
+      g_source_remove (priv->pan_motion_cb);
+      pan_motion_cb (home);
+    }
+}
 
-      if (!priv->moved_over_threshold &&
-          ABS (priv->cumulative_x) > HDH_PAN_THRESHOLD)
-        {
-          priv->moved_over_threshold = TRUE;
-          if (priv->press_timeout)
-            priv->press_timeout = (g_source_remove (priv->press_timeout), 0);
-  
-          /* Remove initial jump caused by the threshold */
-          if (priv->cumulative_x > 0)
-            priv->cumulative_x -= HDH_PAN_THRESHOLD;
-          else
-            priv->cumulative_x += HDH_PAN_THRESHOLD;
-        }
+/*
+ * Follows a motion event of a pan.  Touch screens deliver many more of
+ * them than we can draw frames, so only the bookkeeping is done here,
+ * and the views are moved by pan_motion_cb() once all the pending
+ * events have been processed, right before the next frame is drawn.
+ */
+static void
+hd_home_desktop_do_motion (HdHome *home,
+                           int     x,
+                           int     y)
+{
+  HdHomePrivate   *priv = home->priv;
+  gint *cumulative, velocity;
 
-      if (priv->moved_over_threshold)
-        {
-          /* unfocus any applet in case we start panning */
-          mb_wm_client_focus (MB_WM_COMP_MGR (priv->comp_mgr)->wm->desktop);
-          hd_home_view_container_set_offset (
-                          HD_HOME_VIEW_CONTAINER (priv->view_container),
-                          priv->cumulative_x);
-        }
- 
-      priv->last_x = x;
+  /* If the callback is 0, we're getting events after we got a do_release.
+   * This is because clutter has stored up the events, and we're called from
+   * hd_home_applet_motion instead. In this case just ignore, or we end up
+   * in the wrong position (bug 127320) */
+  if (!priv->desktop_motion_cb)
+    return;
+
+  if (priv->pan_vertical)
+    { /* Scrolling in portrait mode */
+      cumulative = &priv->cumulative_y;
+      *cumulative += y - priv->last_y;
+      velocity = add_drag (home, y - priv->last_y);
+      priv->velocity_y = *cumulative < 0 ? -velocity : velocity;
     }
   else
-    { /* Scrolling in portrait mode */
-      drag_item->y = y - priv->last_y;
-      priv->cumulative_y += drag_item->y;
-  
-      DRAG_DEBUG("drag motion %dms, %dx%d -> %d", (int)(drag_item->period*1000),
-                 x, y, drag_item->x);
-
-      /* Remove any items older than a certain age */
-      time = 0;
-      drag_distance = 0;
-      list = priv->drag_list;
-      while (list)
-        {
-          GList *next = list->next;
-          /* '&& next' ensures that we always average at least one previous
-           * movement event to get our velocity, even if it is too old. */
-          if (time > HDH_PAN_VELOCITY_HISTORY && next) {
-            g_free (list->data);
-            priv->drag_list = g_list_delete_link(priv->drag_list, list);
-          }
-          else
-            {
-              HdHomeDrag *drag = (HdHomeDrag*)list->data;
-              time += drag->period;
-              drag_distance += ABS(drag->y);
-            }
-          list = next;
-        }
-      /* Add new item to drag list */
-      priv->drag_list = g_list_prepend(priv->drag_list, drag_item);
-      /* Set velocity */
-      time += drag_item->period;
-      drag_distance += ABS(drag_item->y);
-      if (time > 0)
-        priv->velocity_y = drag_distance / time;
-      else
-        priv->velocity_y = 0;
-      if (priv->cumulative_y < 0)
-        priv->velocity_y = -priv->velocity_y;
- 
-      if (!priv->moved_over_threshold &&
-          ABS (priv->cumulative_y) > HDH_PAN_THRESHOLD)
-        {
-          priv->moved_over_threshold = TRUE;
-          if (priv->press_timeout)
-            priv->press_timeout = (g_source_remove (priv->press_timeout), 0);
-  
-          /* Remove initial jump caused by the threshold */
-          if (priv->cumulative_y > 0)
-            priv->cumulative_y -= HDH_PAN_THRESHOLD;
-          else
-            priv->cumulative_y += HDH_PAN_THRESHOLD;
-        }
+    { /* Scrolling in landscape mode */
+      cumulative = &priv->cumulative_x;
+      *cumulative += x - priv->last_x;
+      velocity = add_drag (home, x - priv->last_x);
+      priv->velocity_x = *cumulative < 0 ? -velocity : velocity;
+    }
+  priv->last_x = x;
+  priv->last_y = y;
 
-      if (priv->moved_over_threshold)
-        {
-          /* unfocus any applet in case we start panning */
-          mb_wm_client_focus (MB_WM_COMP_MGR (priv->comp_mgr)->wm->desktop);
-          hd_home_view_container_set_offset (
-                          HD_HOME_VIEW_CONTAINER (priv->view_container),
-                          priv->cumulative_y);
-        }
+  if (!priv->moved_over_threshold &&
+      ABS (*cumulative) > HDH_PAN_THRESHOLD)
+    {
+      priv->moved_over_threshold = TRUE;
+      if (priv->press_timeout)
+        priv->press_timeout = (g_source_remove (priv->press_timeout), 0);
+
+      /* Remove initial jump caused by the threshold */
+      if (*cumulative > 0)
+        *cumulative -= HDH_PAN_THRESHOLD;
+      else
+        *cumulative += HDH_PAN_THRESHOLD;
 
-      priv->last_y = y;
+      /* unfocus any applet in case we start panning */
+      mb_wm_client_focus (MB_WM_COMP_MGR (priv->comp_mgr)->wm->desktop);
     }
+
+  if (!priv->pan_motion_cb)
+    priv->pan_motion_cb = clutter_threads_add_idle_full (
+                                        CLUTTER_PRIORITY_REDRAW - 1,
+                                        (GSourceFunc)pan_motion_cb,
+                                        home, NULL);
 }
 
 static void
@@ -532,19 +519,15 @@ hd_home_desktop_do_release (HdHome *home)
   if (priv->press_timeout)
     priv->press_timeout = (g_source_remove (priv->press_timeout), 0);
 
+  flush_pan_motion (home);
   if (priv->desktop_motion_cb)
     mb_wm_main_context_x_event_handler_remove (wm->main_ctx,
 					       MotionNotify,
 					       priv->desktop_motion_cb);
 
   priv->desktop_motion_cb = 0;
-  /* Free drag history */
-  g_list_foreach(priv->drag_list, (GFunc)g_free, 0);
-  g_list_free(priv->drag_list);
-  priv->drag_list = 0;
 
-  if(STATE_IS_PORTRAIT(hd_render_manager_get_state ())
-      && priv->vertical_scrolling)
+  if (priv->pan_vertical)
     {
       cumulative_value = priv->cumulative_y;
       velocity_value = priv->velocity_y;
@@ -631,6 +614,8 @@ hd_home_desktop_do_press (HdHome *home,
 
   DRAG_DEBUG("drag press %dx%d", x, y);
 
+  if (priv->pan_motion_cb)
+    priv->pan_motion_cb = (g_source_remove (priv->pan_motion_cb), 0);
   if (priv->desktop_motion_cb)
     {
       mb_wm_main_context_x_event_handler_remove (wm->main_ctx,
@@ -697,9 +682,9 @@ hd_home_desktop_do_press (HdHome *home,
   priv->velocity_y = 0;
   g_timer_reset(priv->last_move_time);
   /* Make sure drag history is clear */
-  g_list_foreach(priv->drag_list, (GFunc)g_free, 0);
-  g_list_free(priv->drag_list);
-  priv->drag_list = 0;
+  priv->drag_head = priv->drag_count = 0;
+  priv->pan_vertical = STATE_IS_PORTRAIT (hd_render_manager_get_state ())
+    && priv->vertical_scrolling;
 
   priv->desktop_motion_cb =
     mb_wm_main_context_x_event_handler_add (wm->main_ctx,
@@ -1674,6 +1659,8 @@ hd_home_dispose (GObject *object)
 
   if (priv->press_timeout)
     priv->press_timeout = (g_source_remove (priv->press_timeout), 0);
+  if (priv->pan_motion_cb)
+    priv->pan_motion_cb = (g_source_remove (priv->pan_motion_cb), 0);
 
   G_OBJECT_CLASS (hd_home_parent_class)->dispose (object);
 }
@@ -1748,6 +1735,9 @@ _hd_home_do_edit_layout (HdHome *home)
   clutter_actor_set_position (priv->edit_group, 0, 0);
   clutter_actor_show (priv->edit_group);
 
+  /* Get the indicators ready now rather than when an applet is
+   * first dragged. */
+  layout_edge_indication (home);
   update_edge_indication_visibility (home,
                                      EDGE_INDICATION_OPACITY_INVISIBLE,
                                      EDGE_INDICATION_OPACITY_INVISIBLE);
@@ -2569,6 +2559,22 @@ hd_home_set_operator_applet (HdHome *home, ClutterActor *applet)
     }
 }
 
+static void
+set_edge_indication_opacity (ClutterActor *edge_indication, guint8 opacity)
+{
+  if (!opacity)
+    {
+      clutter_actor_hide (edge_indication);
+      return;
+    }
+
+  /* Called for every motion event while an applet is dragged,
+   * so don't queue redraws unless something actually changes. */
+  if (clutter_actor_get_opacity (edge_indication) != opacity)
+    clutter_actor_set_opacity (edge_indication, opacity);
+  clutter_actor_show (edge_indication);
+}
+
 static void
 update_edge_indication_visibility (HdHome *home,
                                    guint8  left_opacity,
@@ -2576,35 +2582,30 @@ update_edge_indication_visibility (HdHome *home,
 {
   HdHomePrivate *priv = home->priv;
 
-  if (left_opacity &&
-      hd_home_view_container_get_previous_view (HD_HOME_VIEW_CONTAINER (priv->view_container)))
-    {
-      clutter_actor_show (priv->edge_indication_left);
-      clutter_actor_set_opacity (priv->edge_indication_left, left_opacity);
-    }
-  else
-    {
-      clutter_actor_hide (priv->edge_indication_left);
-    }
+  if (!hd_home_view_container_get_previous_view (HD_HOME_VIEW_CONTAINER (priv->view_container)))
+    left_opacity = EDGE_INDICATION_OPACITY_INVISIBLE;
+  if (!hd_home_view_container_get_next_view (HD_HOME_VIEW_CONTAINER (priv->view_container)))
+    right_opacity = EDGE_INDICATION_OPACITY_INVISIBLE;
 
-  if (right_opacity &&
-      hd_home_view_container_get_next_view (HD_HOME_VIEW_CONTAINER (priv->view_container)))
-    {
-      clutter_actor_show (priv->edge_indication_right);
-      clutter_actor_set_opacity (priv->edge_indication_right, right_opacity);
-    }
-  else
-    {
-      clutter_actor_hide (priv->edge_indication_right);
-    }
+  set_edge_indication_opacity (priv->edge_indication_left, left_opacity);
+  set_edge_indication_opacity (priv->edge_indication_right, right_opacity);
 }
 
-void
-hd_home_show_edge_indication (HdHome *home)
+/* Sizes and places the edge indicators for the current orientation. */
+static void
+layout_edge_indication (HdHome *home)
 {
   HdHomePrivate *priv = home->priv;
+  gboolean portrait;
+
+  portrait = STATE_IS_PORTRAIT (hd_render_manager_get_state ());
+  if (priv->edge_indication_laid_out
+      && priv->edge_indication_portrait == portrait)
+    return;
+  priv->edge_indication_laid_out = TRUE;
+  priv->edge_indication_portrait = portrait;
 
-  if (STATE_IS_PORTRAIT (hd_render_manager_get_state ()))
+  if (portrait)
     {
       if (priv->vertical_scrolling)
         {
@@ -2634,7 +2635,12 @@ hd_home_show_edge_indication (HdHome *home)
       clutter_actor_set_position (priv->edge_indication_right,
                                   HD_COMP_MGR_LANDSCAPE_WIDTH - HD_EDGE_INDICATION_WIDTH, 0);
     }
+}
 
+void
+hd_home_show_edge_indication (HdHome *home)
+{
+  layout_edge_indication (home);
   update_edge_indication_visibility (home,EDGE_INDICATION_OPACITY_WIDGET_MOVING,
                                      EDGE_INDICATION_OPACITY_WIDGET_MOVING);
 }
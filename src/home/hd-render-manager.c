@@ -1536,6 +1536,8 @@ void hd_render_manager_set_state(HDRMStateEnum state)
                                                                TRUE);
               mb_wm_comp_mgr_clutter_client_track_damage (
                     MB_WM_COMP_MGR_CLUTTER_CLIENT (c->cm_client), True);
+              /* except what we don't want to track */
+              hd_util_reset_damage_tracking (c);
             }
 
           /* this is needed, otherwise task switcher background can remain
@@ -1750,7 +1752,8 @@ void hd_render_manager_set_state(HDRMStateEnum state)
       if (STATE_NEED_DESKTOP(state) != STATE_NEED_DESKTOP(oldstate))
         mb_wm_handle_show_desktop(wm, STATE_NEED_DESKTOP(state));
 
-      if (STATE_SHOW_APPLETS(state) != STATE_SHOW_APPLETS(oldstate))
+      if (STATE_SHOW_APPLETS(state) != STATE_SHOW_APPLETS(oldstate)
+          || STATE_NEED_DESKTOP(state) != STATE_NEED_DESKTOP(oldstate))
         {
           hd_comp_mgr_update_applets_on_current_desktop_property (HD_COMP_MGR (cmgr));
         }
@@ -2561,6 +2564,13 @@ void hd_render_manager_pause_blur_animation()
                     CLUTTER_ACTOR(render_manager->priv->home_blur));
 }
 
+/* Called by hd-task-navigator when it's idle so blurring the background
+ * has less to do when it's entered. */
+void hd_render_manager_prewarm_blur()
+{
+  tidy_blur_group_prewarm(CLUTTER_ACTOR(render_manager->priv->home_blur));
+}
+
 /* This is called when we are in the launcher subview so that we can blur and
  * darken the background even more */
 void hd_render_manager_set_launcher_subview(gboolean subview)
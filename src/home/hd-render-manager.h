@@ -273,6 +273,9 @@ void hd_render_manager_unzoom_background(void);
 /* If something that is blurred has changed, update it. */
 void hd_render_manager_blurred_changed(void);
 
+/* Prepare blurring the background before it's needed. */
+void hd_render_manager_prewarm_blur(void);
+
 /* Gets the current coordinates of the title. */
 void hd_render_manager_get_title_xy (int *x, int *y);
 
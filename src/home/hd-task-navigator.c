@@ -14,7 +14,7 @@
  * Thumbnail.thwin hierarchy:
  *   .prison                    #ClutterGroup         applications
  *     .titlebar                #ClutterGroup
- *     .windows                 #ClutterGroup
+ *     .windows                 #TidyCachedGroup
  *       .apwin                 #ClutterActor
  *       .dialogs               #ClutterActor
  *     .video                   #ClutterTexture
@@ -28,7 +28,8 @@
  *       .frame.nw, .nm, .ne    #ClutterCloneTexture  applications
  *       .frame.mw,      .mw    #ClutterCloneTexture  applications
  *       .frame.sw, .sm, .sw    #ClutterCloneTexture  applications
- *     .title                   #ClutterLabel
+ *     .title_image             #TidyCachedGroup
+ *       .title                 #ClutterLabel
  *     .close                   #ClutterGroup
  *       .icon_app, .icon_notif #ClutterCloneTexture
  *
@@ -48,6 +49,7 @@
 #include <clutter/clutter.h>
 #include <tidy/tidy-finger-scroll.h>
 #include <tidy/tidy-desaturation-group.h>
+#include <tidy/tidy-cached-group.h>
 
 #include <matchbox/core/mb-wm.h>
 #include <matchbox/comp-mgr/mb-wm-comp-mgr.h>
@@ -67,6 +69,8 @@
 #include "hd-util.h"
 #include "hd-gtk-style.h"
 #include "hd-app-mgr.h"
+#include "hd-icon-cache.h"
+#include "hd-icon-loader.h"
 /* }}} */
 
 /* Standard definitions {{{ */
@@ -190,6 +194,35 @@
 #define NOTIFADE_OUT_DURATION     \
   hd_transition_get_int("task_nav", "notifade_out", 250)
 
+/*
+ * %THUMB_REFRESH_RATE:           How many times a second may the cached
+ *                                image of a thumbnail be redrawn at most.
+ *                                0 means no limit.
+ * %THUMB_REFRESH_RATE_FOCUSED:   Likewise for the @Focus thumbnail.
+ */
+#define THUMB_REFRESH_RATE        \
+  hd_transition_get_int("task_nav", "thumb_refresh_rate", 5)
+#define THUMB_REFRESH_RATE_FOCUSED \
+  hd_transition_get_int("task_nav", "thumb_refresh_rate_focused", 15)
+
+/*
+ * %THUMB_CACHE_KB:               How many kilobytes may the cached images
+ *                                of thumbnails take when we're not shown.
+ *                                They're all freed under low memory.
+ */
+#define THUMB_CACHE_KB            \
+  hd_transition_get_int("task_nav", "thumb_cache_kb", 2048)
+
+/*
+ * %PREWARM_DELAY:                How many milliseconds to wait after we've
+ *                                been left or a window has been added before
+ *                                preparing what to show when we're entered
+ *                                next time, if nothing else is going on.
+ *                                0 disables it.
+ */
+#define PREWARM_DELAY             \
+  hd_transition_get_int("task_nav", "prewarm_delay", 0)
+
 #define THUMB_DESATURATION_ENABLED     \
   hd_transition_get_int("thp_tweaks", "thumb_desaturation", 0)
 
@@ -284,6 +317,15 @@ typedef struct
   HdNote                      *hdnote;
   unsigned long                hdnote_changed_cb_id;
 
+  /*
+   * -- @older:               The earlier notifications of the same
+   *                          thread as @hdnote, the newest first, each
+   *                          mb_wm_object_ref()ed.  They are only shown
+   *                          in @count, so they have no actors of their
+   *                          own however many of them pile up.
+   */
+  GList                       *older;
+
   /*
    * -- @notwin:              Wraps for all the rest, nothing more.
    *                          In purpose similar to %Thumbnail::prison.
@@ -331,6 +373,9 @@ typedef struct
    *                  of as a boilerplate.
    * -- @title:       What to put in the thumbnail's title area.
    *                  Centered vertically within TITLE_HEIGHT.
+   * -- @title_image: Wraps @title and paints a cached image of it,
+   *                  which is only redrawn when its text, colour or
+   *                  size changes, not every time the switcher is.
    * -- @close:       An invisible actor reacting to user taps to close
    *                  the thumbnail.  Slightly reaches out of the thumbnail
    *                  bounds.  Also contains the icons.
@@ -348,7 +393,7 @@ typedef struct
    *                  and the other is opaque.  Otherwise the opposit holds.
    */
   ClutterActor        *thwin, *plate;
-  ClutterActor        *title, *close;
+  ClutterActor        *title, *title_image, *close;
   ClutterActor        *close_app_icon, *close_notif_icon;
 
   /* TODO This should go to a dynamically allocated structure like .tnote. */
@@ -379,6 +424,11 @@ typedef struct
        *                  when the %Thumbnail has a @video.  Also clips its
        *                  contents to @App_window_geometry, making sure that
        *                  really nothing is shown outside the thumbnail.
+       *                  While we're active it paints a downscaled image
+       *                  of its contents, which is redrawn when they are
+       *                  damaged, but not more often than the
+       *                  %THUMB_REFRESH_RATE allows.  The windows are
+       *                  painted directly while zooming.
        * -- @titlebar:    An actor that looks like the original title bar.
        *                  Faded in/out when zooming in/out, but normally
        *                  transparent or not visible at all.
@@ -433,11 +483,13 @@ typedef struct
        *                        because it's woken up.
        * -- @title_had_markup:  Mirrors @win::name_has_markup similarly to
        *                        @saved_title.
+       * -- @title_stale:       The window's name has changed while we were
+       *                        not shown, and the title is yet to be reset.
        */
       MBWMClientWindow    *win;
       unsigned long        win_changed_cb_id;
       gchar               *saved_title;
-      gboolean             title_had_markup;
+      gboolean             title_had_markup, title_stale;
 
       /*
        * -- @nodest:      What notifications this thumbnails is destination for.
@@ -465,6 +517,35 @@ typedef struct
       ClutterActor        *video;
       const gchar         *video_fname;
       time_t               video_mtime;
+
+      /*
+       * -- @video_req:   The loading of the @video for @video_req_mtime
+       *                  in progress or %NULL.  @windows are shown
+       *                  until it's done.  It may have been started
+       *                  by prewarm() before @video_mtime was known.
+       */
+      HdIconRequest       *video_req;
+      time_t               video_req_mtime;
+
+      /*
+       * -- @cached:      Whether @windows is painted from its cached image.
+       * -- @refresh_cb:  The source of the delayed redrawing of the
+       *                  cached image of @windows or 0.
+       * -- @refreshed:   When was the cached image last redrawn,
+       *                  in g_get_monotonic_time() units, or 0 if
+       *                  it hasn't been since it was freed.
+       * -- @downsample:  How much @windows is downscaled when cached.
+       *                  Follows the scale of @prison.
+       * -- @generation:  The content generation of @windows when the
+       *                  cached image was last redrawn, or 0 if we
+       *                  don't know.  The image is kept when we leave,
+       *                  and it's reused next time unless this differs.
+       */
+      gboolean             cached;
+      guint                refresh_cb;
+      gint64               refreshed;
+      gfloat               downsample;
+      guint                generation;
     };
 
     /* Currently we don't have notification-specific fields. */
@@ -478,6 +559,13 @@ typedef struct
   TNote               *tnote;
   time_t last_activated;
 
+  /*
+   * -- @xcell, @ycell: Where layout_thumbs() has last placed @thwin
+   *                    in the @Grid.  Thumbnails which stay in their
+   *                    cell are not touched by the next layout.
+   */
+  guint xcell, ycell;
+
   /* -- @portrait_supported: Application supports portrait?
    *                         TODO: Check if is it possible support
    *                         to be changed while in task navigator?
@@ -485,6 +573,25 @@ typedef struct
   gboolean portrait_supported;
 
 } Thumbnail; /* }}} */
+
+/* Video screenshots {{{ */
+/* A video screenshot being loaded for @apthumb.  Only @apthumb may be
+ * changed once the request is made, the rest is read by the worker. */
+typedef struct
+{
+  Thumbnail *apthumb;
+  time_t mtime;
+  guint width, height;
+} VideoLoad;
+
+/* A decoded video screenshot in @Videos and the modification time
+ * of the file it's been loaded from. */
+typedef struct
+{
+  GdkPixbuf *pixbuf;
+  time_t mtime;
+} VideoCacheEntry;
+/* }}} */
 /* Thumbnail data structures }}} */
 
 /* Clutter effect data structures {{{ */
@@ -504,7 +611,7 @@ typedef struct
 } Flyops;
 
 /* For linear_effect(), resize_effect() and turnoff_effect(). */
-typedef struct
+typedef struct EffectClosure
 {
   /*
    * @actor:                    The actor to be animated (refed).
@@ -512,58 +619,42 @@ typedef struct
    *                            a thwin.
    * @timeline:                 Used when one wants to cancel an effect
    *                            outside of the timeline.
-   * @new_frame_cb_id, @timeline_complete_cb_id:
-   *                            %ClutterTimeline signal handler IDs
-   *                            @new_frame_cb_id can be 0.
-   * @frame_fun:                Just about any value that can identify
-   *                            an effect.  Typically the effect's
-   *                            new-frame callback.  Can be %NULL.
+   * @effectid:                 Just about any value that can identify
+   *                            an effect.  Typically the function
+   *                            setting the animated properties.
+   * @animator, @track:         The #Animator running the effect and
+   *                            the effect's index in its arrays.
+   * @frame_fun:                Called in every frame for effects that
+   *                            are not linear.  Can be %NULL.
+   * @complete_fun:             Called when @timeline is "completed".
+   * @completing:               Whether @complete_fun is due in the
+   *                            current "completed" emission.
    */
   ClutterActor *actor;
   ClutterTimeline *timeline;
-  gulong new_frame_cb_id, timeline_complete_cb_id;
   gconstpointer effectid;
+  struct Animator *animator;
+  guint track;
+  void (*frame_fun)(ClutterTimeline *, gint, struct EffectClosure *);
+  void (*complete_fun)(ClutterTimeline *, struct EffectClosure *);
+  gboolean completing;
 
   /* Effect-specific context */
   union
   {
-    /* For linear_effect()s. */
+    /* For fade(). */
     struct
     {
-      /*
-       * In each frame a number of properties of @actor is changed lineraly,
-       * such as width and height.  Each property has its own structure.
-       * The number of properties that can be controlled by such an effect
-       * is limited by the the number of elements in the array.
-       */
-      struct
-      {
-        /*
-         * @init:             The property's value at the start of the effect.
-         * @diff:             By the end of effect how much the property should
-         *                    be different with regards to @init.
-         */
-        gfloat init, diff;
-      } linear[2];
-
-      /* Auxiliary instruction for linear_effect()s. */
-      union
+      /* What to do when the effect completes. */
+      enum final_fade_action_t
       {
-        /* For fade(). */
-        struct
-        {
-          /* What to do when the effect completes. */
-          enum final_fade_action_t
-          {
-            FINALLY_REST,   /* Nothing is necessary. */
-            FINALLY_HIDE,   /* Hide @another_actor. */
-            FINALLY_REMOVE, /* Remove EffectClosure::actor
-                             * from @another_actor. */
-          } finally;
-
-          ClutterActor *another_actor;
-        };
-      };
+        FINALLY_REST,   /* Nothing is necessary. */
+        FINALLY_HIDE,   /* Hide @another_actor. */
+        FINALLY_REMOVE, /* Remove EffectClosure::actor
+                         * from @another_actor. */
+      } finally;
+
+      ClutterActor *another_actor;
     };
 
     /* This is used by resize_effect() on __armel__. */
@@ -593,6 +684,38 @@ typedef struct
   };
 } EffectClosure;
 
+/* Sets two properties of @actor, like clutter_actor_set_position(). */
+typedef void (*EffectSetFun)(ClutterActor *actor, gfloat val1, gfloat val2);
+
+/*
+ * The line along which a linear effect changes the properties.
+ * @init:             The properties' values at the start of the effect.
+ * @diff:             By the end of effect how much the properties should
+ *                    be different with regards to @init.
+ */
+typedef struct
+{
+  gfloat init[2], diff[2];
+} EffectLine;
+
+/*
+ * Runs all the effects of a timeline with one "new-frame" and one
+ * "completed" handler.  The effects are kept as a struct of arrays:
+ * effect #i is @closures[i], animating @actors[i] with @setters[i]
+ * along @lines[i], so a frame is a single pass over the arrays without
+ * touching the closures of linear effects.  @setters[i] is %NULL for
+ * effects which have a frame_fun or nothing to do in the frames.
+ * @completing tells whether we're in the middle of completing them.
+ */
+typedef struct Animator
+{
+  ClutterTimeline *timeline;
+  gulong new_frame_cb_id, completed_cb_id;
+  GPtrArray *closures, *actors;
+  GArray *setters, *lines;
+  gboolean completing;
+} Animator;
+
 /* Used by add_effect_closure() to store what to call when the effect
  * completes. */
 typedef struct
@@ -711,6 +834,10 @@ static const Flyops Fly_smoothly =
 static gboolean
 hd_task_navigator_app_portrait_capable(Thumbnail * thumb);
 static void hd_task_navigator_set_disable_portrait(Thumbnail * thumb,gboolean disable);
+static void set_thumb_scale (Thumbnail * apthumb,
+                             gdouble xscale, gdouble yscale);
+static void unindex_appthumb (const Thumbnail * apthumb);
+static void close_tnote (const TNote * tnote);
 
 /* Private variables {{{ */
 /*
@@ -735,10 +862,25 @@ static ClutterActor *Navigator, *Scroller;
  */
 static GList *Thumbnails, *Notifications;
 static guint NThumbnails;
+
+/*
+ * -- @Apwins:            Maps the .apwin:s of the application thumbnails
+ *                        in @Thumbnails to their %Thumbnail:s.
+ * -- @Dialog_owners:     Likewise for their .dialogs, so the window
+ *                        manager's calls needn't walk the whole list.
+ * -- @Xwindows:          Likewise for the X windows of their .win:s.
+ * -- @Thumb_windows:     Likewise for their .windows, which is where
+ *                        the compositor's damage is reported from.
+ */
+static GHashTable *Apwins, *Dialog_owners, *Xwindows, *Thumb_windows;
 static const GtkRequisition *Thumbsize;
 /* Do we have notifications since we were last in task navigator? */
 static gboolean UnseenNotifications = FALSE;
 
+/* The application thumbnail we have zoomed out of, if any, whose image
+ * is kept more up to date than the others'.  Cleared when we leave. */
+static const Thumbnail *Focus;
+
 /*
  * Effect templates and their corresponding timelines.
  * -- @Fly_effect:  For moving thumbnails and notification windows around
@@ -752,13 +894,25 @@ static ClutterTimeline *Fly_effect_timeline, *Zoom_effect_timeline;
 static ClutterTransition *Fade_in_transition, *Fade_out_transition;
 
 /*
- * The list of currently running effects created with new_effect().
- * Practically these are all effects used for flying.  Used to learn
- * if a particular effect is already running and if so change it,
- * rather than dumbly adding a new effect and create races between
- * then two of them.  Contains pointers to %EffectClosure:s.
+ * The set of currently running effects created with new_effect(),
+ * hashed by their actor and effectid.  Practically these are all
+ * effects used for flying.  Used to learn if a particular effect is
+ * already running and if so change it, rather than dumbly adding
+ * a new effect and create races between then two of them.
+ * @Animators maps the timelines of the effects to their #Animator:s.
+ */
+static GHashTable *Effects, *Animators;
+
+/*
+ * Decoded video screenshots, hashed by file name.  Entries are replaced
+ * when the file is newer than the image, and removed when the file is
+ * gone or the last thumbnail of the application is, so there's at most
+ * one for each running application with a screenshot.
  */
-static GPtrArray *Effects;
+static GHashTable *Videos;
+
+/* The source of the pending prewarm(), if any. */
+static guint Prewarm_cb;
 
 /* gtkrc articles */
 static const gchar *LargeSystemFont, *SystemFont, *SmallSystemFont;
@@ -811,17 +965,17 @@ damage_control: __attribute__((unused))
 }
 
 /* Loads @fname, resizing and cropping it as necessary to fit
- * in a @aw x @ah rectangle.  Returns %NULL on error. */
-static ClutterActor *
-load_image (char const * fname, guint aw, guint ah)
+ * in a @load->width x @load->height rectangle at half resolution.
+ * Returns %NULL on error.  Called in the icon loader's worker thread. */
+static GdkPixbuf *
+decode_video (const gchar * fname, gpointer data)
 {
+  const VideoLoad *load = data;
   GError *err;
   GdkPixbuf *pixbuf;
   gint dx, dy;
   gdouble dsx, dsy, scale;
-  guint vw, vh, sw, sh, dw, dh;
-  ClutterActor *final;
-  ClutterActor *texture;
+  guint aw, ah, vw, vh, sw, sh, dw, dh;
 
   /* On error the caller sure has better recovery plan than an
    * empty rectangle.  (ie. showing the real application window). */
@@ -829,6 +983,7 @@ load_image (char const * fname, guint aw, guint ah)
   if (!(pixbuf = gdk_pixbuf_new_from_file (fname, &err)))
     {
       g_warning ("%s: %s", fname, err->message);
+      g_error_free (err);
       return NULL;
     }
 
@@ -842,6 +997,8 @@ load_image (char const * fname, guint aw, guint ah)
    * more we will scale it down before we create its #ClutterTexture.
    * This is to reduce texture memory consumption.
    */
+  aw = load->width;
+  ah = load->height;
   vw = aw / 2;
   vh = ah / 2;
 
@@ -897,7 +1054,25 @@ load_image (char const * fname, guint aw, guint ah)
       pixbuf = tmp;
     }
 
-  if (!(texture = pixbuf2texture (pixbuf)))
+  return pixbuf;
+}
+
+/* Makes an actor of @pixbuf, as returned by decode_video(), which
+ * appears to be @aw x @ah large.  Returns %NULL on error. */
+static ClutterActor *
+video_actor (GdkPixbuf * pixbuf, guint aw, guint ah)
+{
+  guint vw, vh, dw, dh;
+  ClutterActor *final;
+  ClutterActor *texture;
+
+  vw = aw / 2;
+  vh = ah / 2;
+  dw = gdk_pixbuf_get_width (pixbuf);
+  dh = gdk_pixbuf_get_height (pixbuf);
+
+  /* @pixbuf may be in the @Videos cache, don't let it be destroyed. */
+  if (!(texture = pixbuf2texture (g_object_ref (pixbuf))))
     return NULL;
 
   /* If @pixbuf is smaller than desired place it centered
@@ -928,7 +1103,47 @@ load_image (char const * fname, guint aw, guint ah)
   return final;
 }
 
-/* Loads an icon as a #ClutterTexture.  Returns %NULL on error. */
+/* Cancels loading @icon if it's still in progress. */
+static void
+cancel_icon_load (ClutterActor *icon)
+{
+  HdIconRequest *req;
+
+  if ((req = g_object_steal_data (G_OBJECT (icon), "HD-icon-request")))
+    hd_icon_loader_cancel (req);
+}
+
+/* The request holds a reference on @icon, so it wouldn't go away if
+ * the thumbnail is closed before it's loaded. */
+static void
+icon_parent_set (ClutterActor *icon, ClutterActor *old_parent)
+{
+  if (!clutter_actor_get_parent (icon))
+    cancel_icon_load (icon);
+}
+
+/* The loader keeps the aspect ratio of the icon, so make it appear
+ * centered on the @isize x @isize area it was meant to fill. */
+static void
+icon_loaded (ClutterTexture *icon, gboolean loaded, gpointer isize)
+{
+  gint w, h;
+
+  g_object_steal_data (G_OBJECT (icon), "HD-icon-request");
+  if (!loaded)
+    return;
+
+  clutter_texture_get_base_size (icon, &w, &h);
+  clutter_actor_set_size (CLUTTER_ACTOR (icon), w, h);
+  clutter_actor_set_anchor_point (CLUTTER_ACTOR (icon),
+                                  (w - (gint)GPOINTER_TO_UINT (isize)) / 2,
+                                  (h - (gint)GPOINTER_TO_UINT (isize)) / 2);
+}
+
+/* Returns a #ClutterTexture which the icon will be loaded into
+ * in the background unless it's in the icon cache, or %NULL if
+ * there's no such icon.  Until it's loaded the texture is @isize
+ * large. */
 static ClutterActor *
 load_icon (const gchar * iname, guint isize)
 {
@@ -941,60 +1156,47 @@ load_icon (const gchar * iname, guint isize)
                                            anyad, isize, 0)))
     return NULL;
 
-  icon = (iname = gtk_icon_info_get_filename (icinf)) != NULL
-    ? clutter_texture_new_from_file (iname, NULL) : NULL;
+  if ((iname = gtk_icon_info_get_filename (icinf)) != NULL)
+    {
+      HdIconRequest *req;
+
+      icon = clutter_texture_new ();
+      clutter_actor_set_size (icon, isize, isize);
+      req = hd_icon_cache_load (CLUTTER_TEXTURE (icon), iname, isize, 0,
+                                icon_loaded, GUINT_TO_POINTER (isize));
+      if (req)
+        {
+          g_object_set_data (G_OBJECT (icon), "HD-icon-request", req);
+          g_signal_connect (icon, "parent-set",
+                            G_CALLBACK (icon_parent_set), NULL);
+          g_signal_connect (icon, "destroy",
+                            G_CALLBACK (cancel_icon_load), NULL);
+        }
+    }
+  else
+    icon = NULL;
   gtk_icon_info_free (icinf);
 
   return icon;
 }
 
 /* Searches for an icon with name @iname and size @isize.
- * If it can't find or load it returns a hidden actor.
- * Otherwise the icon's texture is cached. */
+ * If it can't find it returns a hidden actor. */
 static ClutterActor *
 get_icon (const gchar * iname, guint isize)
 {
-  static GHashTable *cache;
   ClutterActor *icon;
-  gchar *ikey;
-  gfloat w, h;
 
-  if (!iname)
-    goto out;
-
-  /* Is it cached?  We can't use %HdClutterCache because that doesn't
-   * handle icons and we may need to load the same icon with different
-   * sizes. */
-  ikey = g_strdup_printf ("%s-%u", iname, isize);
-  if (cache && (icon = g_hash_table_lookup (cache, ikey)) != NULL)
-    { /* Yeah */
-      g_free (ikey);
-    }
-  else if ((icon = load_icon (iname, isize)) != NULL)
-    { /* No, but we could load it. */
-      if (!cache)
-        cache = g_hash_table_new_full (g_str_hash, g_str_equal,
-                                       g_free, g_object_unref);
-      g_hash_table_insert (cache, ikey, icon);
-    }
-  else
-    { /* Couldn't load it. */
-      g_free (ikey);
-      g_critical ("%s: failed to load icon", iname);
-      goto out;
+  if (iname && (icon = load_icon (iname, isize)) != NULL)
+    {
+      clutter_actor_set_name (icon, iname);
+      return icon;
     }
 
-  /* Icon found.  Set its anchor such that if @icon's real size differs
-   * from the requested @isize then @icon would look as if centered on
-   * an @isize large area. */
-  icon = clutter_clone_new (icon);
-  clutter_actor_set_name (icon, iname);
-  clutter_actor_get_size (icon, &w, &h);
-  clutter_actor_move_anchor_point (icon,
-                                   (gint)(w-isize)/2, (gint)(h-isize)/2);
-  return icon;
+  if (iname)
+    g_critical ("%s: failed to load icon", iname);
 
-out: /* Return something. */
+  /* Return something. */
   icon = clutter_rectangle_new ();
   clutter_actor_set_size (icon, isize, isize);
   clutter_actor_hide (icon);
@@ -1050,59 +1252,177 @@ need_to_animate (ClutterActor * actor)
 
 /* Effects infrastructure {{{ */
 /* General {{{ */
-/* Returns whether @actos has an effect with @frame_fun.  Effects can use it
+static guint
+effect_hash (gconstpointer key)
+{
+  const EffectClosure *closure = key;
+  return GPOINTER_TO_UINT (closure->actor)
+    ^ GPOINTER_TO_UINT (closure->effectid);
+}
+
+static gboolean
+effect_equal (gconstpointer a, gconstpointer b)
+{
+  const EffectClosure *ca = a, *cb = b;
+  return ca->actor == cb->actor && ca->effectid == cb->effectid;
+}
+
+/* Returns whether @actos has an effect with @effectid.  Effects can use it
  * to recognize themselves and modify the existing one rather than starting
  * a new. */
 static EffectClosure *
 has_effect (ClutterActor * actor, gconstpointer effectid)
 {
-  guint i;
-  EffectClosure *closure;
+  EffectClosure key;
 
   if (!Effects)
     return NULL;
 
-  /* Find @actor and @frame_fun in @Effects. */
-  for (i = 0; i < Effects->len; i++)
+  key.actor = actor;
+  key.effectid = effectid;
+  return g_hash_table_lookup (Effects, &key);
+}
+
+/* #ClutterTimeline::new-frame callback of #Animator:s.
+ * Advances all effects of @animator. */
+static void
+animator_frame (ClutterTimeline * timeline, gint frame, Animator * animator)
+{
+  const EffectSetFun *setters;
+  const EffectLine *lines;
+  gfloat now;
+  guint i;
+
+  now = clutter_timeline_get_progress (timeline);
+  setters = (const EffectSetFun *)animator->setters->data;
+  lines = (const EffectLine *)animator->lines->data;
+  for (i = 0; i < animator->setters->len; i++)
+    if (setters[i])
+      setters[i] (g_ptr_array_index (animator->actors, i),
+                  lines[i].init[0] + lines[i].diff[0]*now,
+                  lines[i].init[1] + lines[i].diff[1]*now);
+    else
+      {
+        EffectClosure *closure = g_ptr_array_index (animator->closures, i);
+        if (closure->frame_fun)
+          closure->frame_fun (timeline, frame, closure);
+      }
+}
+
+static void
+free_animator (Animator * animator)
+{
+  g_hash_table_remove (Animators, animator->timeline);
+  g_signal_handler_disconnect (animator->timeline,
+                               animator->new_frame_cb_id);
+  g_signal_handler_disconnect (animator->timeline,
+                               animator->completed_cb_id);
+  g_object_unref (animator->timeline);
+  g_ptr_array_free (animator->closures, TRUE);
+  g_ptr_array_free (animator->actors, TRUE);
+  g_array_free (animator->setters, TRUE);
+  g_array_free (animator->lines, TRUE);
+  g_slice_free (Animator, animator);
+}
+
+/* #ClutterTimeline::completed callback of #Animator:s.  Calls the
+ * complete_fun of all effects, which are expected to free_effect(). */
+static void
+animator_completed (ClutterTimeline * timeline, Animator * animator)
+{
+  guint i;
+
+  /* Effects started by the complete_fun:s are for the next run. */
+  for (i = 0; i < animator->closures->len; i++)
+    ((EffectClosure *)g_ptr_array_index (animator->closures, i))->completing
+      = TRUE;
+
+  /* Go backwards so free_effect() doesn't need to move the rest. */
+  animator->completing = TRUE;
+  i = animator->closures->len;
+  while (i-- > 0)
     {
-      closure = g_ptr_array_index (Effects, i);
-      if (closure->actor == actor && closure->effectid == effectid)
-        return closure;
+      EffectClosure *closure = g_ptr_array_index (animator->closures, i);
+
+      if (closure->completing)
+        {
+          closure->completing = FALSE;
+          closure->complete_fun (timeline, closure);
+        }
+
+      /* @complete_fun may have cancelled other effects as well. */
+      if (i > animator->closures->len)
+        i = animator->closures->len;
     }
+  animator->completing = FALSE;
 
-  return NULL;
+  if (!animator->closures->len)
+    free_animator (animator);
 }
 
-/* Allocates an #EffectClosure and fills in the common fields.
- * Adds signals to @timeline. */
+/* Returns the #Animator of @timeline, creating it if necessary. */
+static Animator *
+get_animator (ClutterTimeline * timeline)
+{
+  Animator *animator;
+
+  if (G_UNLIKELY (!Animators))
+    Animators = g_hash_table_new (NULL, NULL);
+  if ((animator = g_hash_table_lookup (Animators, timeline)) != NULL)
+    return animator;
+
+  animator = g_slice_new0 (Animator);
+  animator->timeline = g_object_ref (timeline);
+  animator->closures = g_ptr_array_new ();
+  animator->actors = g_ptr_array_new ();
+  animator->setters = g_array_new (FALSE, FALSE, sizeof (EffectSetFun));
+  animator->lines = g_array_new (FALSE, FALSE, sizeof (EffectLine));
+  animator->new_frame_cb_id = g_signal_connect (timeline, "new-frame",
+                                          G_CALLBACK (animator_frame),
+                                          animator);
+  animator->completed_cb_id = g_signal_connect (timeline, "completed",
+                                          G_CALLBACK (animator_completed),
+                                          animator);
+  g_hash_table_insert (Animators, timeline, animator);
+
+  return animator;
+}
+
+/* Allocates an #EffectClosure, fills in the common fields and adds it
+ * to the #Animator of @timeline.  @set_fun is for linear effects,
+ * @frame_fun for the others, either or both can be %NULL. */
 static EffectClosure *
 new_effect (ClutterTimeline * timeline, ClutterActor * actor,
+  gconstpointer effectid, EffectSetFun set_fun,
   void (*frame_fun)(ClutterTimeline *, gint, EffectClosure *),
   void (*complete_fun)(ClutterTimeline *, EffectClosure *))
 {
+  static const EffectLine noline;
   EffectClosure *closure;
+  Animator *animator;
+
+  animator = get_animator (timeline);
 
   closure = g_slice_new0 (EffectClosure);
   closure->actor = g_object_ref (actor);
+  closure->timeline = timeline;
+  closure->effectid = effectid;
+  closure->frame_fun = frame_fun;
+  closure->complete_fun = complete_fun;
+
+  closure->animator = animator;
+  closure->track = animator->closures->len;
+  g_ptr_array_add (animator->closures, closure);
+  g_ptr_array_add (animator->actors, actor);
+  g_array_append_val (animator->setters, set_fun);
+  g_array_append_val (animator->lines, noline);
 
-  if (frame_fun)
-    closure->new_frame_cb_id = g_signal_connect (timeline, "new-frame",
-                                                 G_CALLBACK (frame_fun),
-                                                 closure);
-  else
-    closure->new_frame_cb_id = 0;
-  closure->timeline_complete_cb_id = g_signal_connect (timeline, "completed",
-                                              G_CALLBACK (complete_fun),
-                                              closure);
-
-  closure->timeline = g_object_ref (timeline);
   clutter_timeline_start (timeline);
 
   /* Register @closure in @Effects. */
   if (G_UNLIKELY (!Effects))
-    Effects = g_ptr_array_new ();
-  closure->effectid = frame_fun;
-  g_ptr_array_add (Effects, closure);
+    Effects = g_hash_table_new (effect_hash, effect_equal);
+  g_hash_table_insert (Effects, closure, closure);
 
   return closure;
 }
@@ -1113,54 +1433,74 @@ new_effect (ClutterTimeline * timeline, ClutterActor * actor,
 static void
 free_effect (ClutterTimeline * timeline, EffectClosure * closure)
 {
+  Animator *animator = closure->animator;
+  guint track = closure->track;
+
   if (!Effects) /* I'd love to tease kuzak with a grif(:) */
     g_critical ("no Effects");
-  else if (!g_ptr_array_remove_fast (Effects, closure))
+  else if (!g_hash_table_remove (Effects, closure))
     g_critical ("closure not in Effects");
   g_assert (timeline == closure->timeline);
 
-  if (closure->new_frame_cb_id)
-    g_signal_handler_disconnect (timeline, closure->new_frame_cb_id);
-  g_signal_handler_disconnect (timeline, closure->timeline_complete_cb_id);
-  g_object_unref (timeline);
+  /* The last effect takes the place of @closure. */
+  g_ptr_array_remove_index_fast (animator->closures, track);
+  g_ptr_array_remove_index_fast (animator->actors, track);
+  g_array_remove_index_fast (animator->setters, track);
+  g_array_remove_index_fast (animator->lines, track);
+  if (track < animator->closures->len)
+    ((EffectClosure *)g_ptr_array_index (animator->closures, track))->track
+      = track;
+  if (!animator->closures->len && !animator->completing)
+    free_animator (animator);
+
   g_object_unref (closure->actor);
   g_slice_free (EffectClosure, closure);
 }
 /* General }}} */
 
 /* Linear effects {{{ */
+/* Returns where the properties of @closure are going. */
+static inline EffectLine *
+effect_line (const EffectClosure * closure)
+{
+  return &g_array_index (closure->animator->lines, EffectLine,
+                         closure->track);
+}
+
 /*
- * Start or continue a linear effect on @actor during which one or more
+ * Start or continue a linear effect on @actor during which one or two
  * properties of @actor are changed linearly depending on the current
- * progress of @timeline.  If @actor doesn't have a @frame_fun effect yet,
- * it starts a new one.  The named parameters have the same meaning as
- * in new_effect().  The varadic argument list should be pairs of %gdouble:s
- * teminated by a NAN.  Each pair describes the endpoint values of a property.
- * If an effect is already running it is altered such that by the end of
- * @timline the properties will reach their final intended values without
- * jumping.  In @frame_fun the current value of the properties can be
- * queried with linear_effect_value().
+ * progress of @timeline and set with @set_fun, which also identifies
+ * the effect.  If @actor doesn't have a @set_fun effect yet, it starts
+ * a new one.  The varadic argument list should be pairs of %gdouble:s
+ * teminated by a NAN.  Each pair describes the endpoint values of a
+ * property.  If an effect is already running it is retargeted in place
+ * such that by the end of its timeline the properties will reach their
+ * final intended values without jumping.
  */
 static EffectClosure *
 linear_effect (ClutterTimeline * timeline, ClutterActor * actor,
-               void (*frame_fun)(ClutterTimeline *, gint, EffectClosure *),
+               EffectSetFun set_fun,
                void (*complete_fun)(ClutterTimeline *, EffectClosure *),
                ...)
 {
   guint i;
   va_list list;
   gfloat init, final;
+  EffectLine *line;
   EffectClosure *closure;
 
   va_start (list, complete_fun);
-  if (G_LIKELY (!(closure = has_effect (actor, frame_fun))))
+  if (G_LIKELY (!(closure = has_effect (actor, set_fun))))
     {
       /* @init and @diff are parameters of the line. */
-      closure = new_effect (timeline, actor, frame_fun, complete_fun);
+      closure = new_effect (timeline, actor, set_fun, set_fun,
+                            NULL, complete_fun);
+      line = effect_line (closure);
       for (i = 0; !isnanf (init = va_arg (list, gdouble)); i++)
-        { g_assert (i < G_N_ELEMENTS (closure->linear));
-          closure->linear[i].init = init;
-          closure->linear[i].diff = va_arg (list, gdouble) - init;
+        { g_assert (i < G_N_ELEMENTS (line->init));
+          line->init[i] = init;
+          line->diff[i] = va_arg (list, gdouble) - init;
         }
     }
   else
@@ -1173,24 +1513,18 @@ linear_effect (ClutterTimeline * timeline, ClutterActor * actor,
        * As @timeline may not be the already running one ignore it.
        */
       gfloat now = clutter_timeline_get_progress (closure->timeline);
+      line = effect_line (closure);
       for (i = 0; !isnanf (init = va_arg (list, gdouble)); i++)
-        { g_assert (i < G_N_ELEMENTS (closure->linear));
+        { g_assert (i < G_N_ELEMENTS (line->init));
           final = va_arg (list, gdouble);
-          closure->linear[i].diff = (final-init) / (1-now);
-          closure->linear[i].init = final - closure->linear[i].diff;
+          line->diff[i] = (final-init) / (1-now);
+          line->init[i] = final - line->diff[i];
         }
     }
   va_end (list);
 
   return closure;
 }
-
-/* Return the value of @which property at @now. */
-static inline gfloat __attribute__((pure))
-linear_effect_value (const EffectClosure * closure, guint which, gfloat now)
-{ g_assert (which < G_N_ELEMENTS (closure->linear));
-  return closure->linear[which].init + closure->linear[which].diff*now;
-}
 /* Linear effects }}} */
 
 /* Effect closures {{{ */
@@ -1260,15 +1594,11 @@ add_effect_closure (ClutterTimeline * timeline,
  * while @clutter_set_fun is (#ClutterActor, ptype, ptype). */
 #define DEFINE_RMS_EFFECT(effect, ptype,                            \
                           clutter_get_fun, clutter_set_fun)         \
-/* @effect's %ClutterTimeline::new-frame callback. */               \
+/* @effect's #EffectSetFun. */                                      \
 static void                                                         \
-effect##_effect_frame (ClutterTimeline * timeline, gint frame,      \
-                       EffectClosure * closure)                     \
+effect##_effect_set (ClutterActor * actor, gfloat val1, gfloat val2) \
 {                                                                   \
-  gfloat now = clutter_timeline_get_progress (timeline);            \
-  clutter_set_fun (closure->actor,                                  \
-                   linear_effect_value (closure, 0, now),           \
-                   linear_effect_value (closure, 1, now));          \
+  clutter_set_fun (actor, val1, val2);                              \
 }                                                                   \
                                                                     \
 static void                                                         \
@@ -1279,7 +1609,7 @@ effect##_effect (ClutterTimeline * timeline, ClutterActor * actor,  \
                                                                     \
   clutter_get_fun (actor, &init1, &init2);                          \
   linear_effect (timeline, actor,                                   \
-                 effect##_effect_frame, free_effect,                \
+                 effect##_effect_set, free_effect,                  \
                  (gdouble)init1, (gdouble)final1,                   \
                  (gdouble)init2, (gdouble)final2,                   \
                  NAN);                                              \
@@ -1305,7 +1635,7 @@ check_and_move (ClutterActor * actor, gfloat xpos_new, gfloat ypos_new)
   clutter_actor_get_position (actor, &xpos_now, &ypos_now);
   if (xpos_now != xpos_new || ypos_now != ypos_new)
     move (actor, xpos_new, ypos_new);
-  else if ((closure = has_effect (actor, move_effect_frame)) != NULL)
+  else if ((closure = has_effect (actor, move_effect_set)) != NULL)
     free_effect (closure->timeline, closure);
 }
 
@@ -1324,7 +1654,7 @@ check_and_resize (ClutterActor * actor, gint width_new, gint height_new)
   clutter_actor_get_size (actor, &width_now, &height_now);
   if (width_now != width_new || height_now != height_new)
     resize (actor, width_new, height_new);
-  else if ((closure = has_effect (actor, resize_effect_frame)) != NULL)
+  else if ((closure = has_effect (actor, resize_effect_set)) != NULL)
     free_effect (closure->timeline, closure);
 }
 #else /* __armel__ */
@@ -1342,7 +1672,7 @@ resize_effect (ClutterTimeline * timeline, ClutterActor * actor,
   gfloat width, height;
   EffectClosure *closure;
 
-  closure = has_effect (actor, resize_effect);
+  closure = has_effect (actor, resize_effect_complete);
   clutter_actor_get_size (actor, &width, &height);
 
   /* Resize now if the final dimension is shorter than the current.
@@ -1362,8 +1692,8 @@ resize_effect (ClutterTimeline * timeline, ClutterActor * actor,
 
   if (!closure)
     {
-      closure = new_effect (timeline, actor, NULL, resize_effect_complete);
-      closure->effectid = resize_effect_complete;
+      closure = new_effect (timeline, actor, resize_effect_complete,
+                            NULL, NULL, resize_effect_complete);
     }
   closure->width  = wfinal;
   closure->height = hfinal;
@@ -1405,7 +1735,7 @@ check_and_scale (ClutterActor * actor, gdouble sx_new, gdouble sy_new)
   clutter_actor_get_scale (actor, &sx_now, &sy_now);
   if (fabs (sx_now - sx_new) > 0.0001 || fabs (sy_now - sy_new) > 0.0001)
     scale (actor, sx_new, sy_new);
-  else if ((closure = has_effect (actor, scale_effect_frame)) != NULL)
+  else if ((closure = has_effect (actor, scale_effect_set)) != NULL)
     free_effect (closure->timeline, closure);
 }
 
@@ -1424,7 +1754,7 @@ check_and_rotate_z (ClutterActor * actor, gfloat angle_new, gfloat z_new)
 
   if (angle_now != angle_new || z_now != z_new)
     rotate_z (actor, angle_new, z_new);
-  else if ((closure = has_effect (actor, rotate_z_effect_frame)) != NULL)
+  else if ((closure = has_effect (actor, rotate_z_effect_set)) != NULL)
     free_effect (closure->timeline, closure);
 }
 
@@ -1458,7 +1788,7 @@ check_and_clip (ClutterActor * actor, gfloat appwgw, gfloat appwgh)
 
   if (appwgw_now != appwgw || appwgh_now != appwgh)
     clip (actor, appwgw, appwgh);
-  else if ((closure = has_effect (actor, clip_effect_frame)) != NULL)
+  else if ((closure = has_effect (actor, clip_effect_set)) != NULL)
     free_effect (closure->timeline, closure);
 }
 
@@ -1480,12 +1810,11 @@ get_clip(ClutterActor * actor, gfloat *appwgw, gfloat *appwgh)
 /* RMS effects }}} */
 
 /* Fading effect {{{ */
-/* frame_fun of fade() */
+/* #EffectSetFun of fade() */
 static void
-fade_frame (ClutterTimeline * timeline, gint frame, EffectClosure * closure)
+fade_set (ClutterActor * actor, gfloat opacity, gfloat unused)
 {
-  clutter_actor_set_opacity (closure->actor, linear_effect_value (closure, 0,
-    clutter_timeline_get_progress (timeline)));
+  clutter_actor_set_opacity (actor, opacity);
 }
 
 /* complete_fun of fade() */
@@ -1514,7 +1843,7 @@ fade (ClutterTimeline * timeline, ClutterActor * actor, guint opacity,
   EffectClosure *closure;
 
   g_assert ((finally == FINALLY_REST) == (another_actor == NULL));
-  closure = linear_effect (timeline, actor, fade_frame, fade_complete,
+  closure = linear_effect (timeline, actor, fade_set, fade_complete,
                            (gdouble)clutter_actor_get_opacity(actor),
                            (gdouble)opacity, NAN);
 
@@ -1552,7 +1881,7 @@ reset_opacity (ClutterActor * actor, guint opacity, gboolean be_shown)
 {
   EffectClosure *closure;
 
-  if ((closure = has_effect (actor, fade_frame)) != NULL)
+  if ((closure = has_effect (actor, fade_set)) != NULL)
     free_effect (closure->timeline, closure);
   clutter_actor_set_opacity (actor, opacity);
   if (be_shown)
@@ -1572,7 +1901,7 @@ turnoff_fun (gdouble x0, gdouble y0, gdouble x1, gdouble y1, gdouble t)
   return ((y1-y0)*cos(t) + (y0*cos(x1)-y1*cos(x0))) / (cos(x1)-cos(x0));
 }
 
-/* ClutterTimeline::new-frame callback for turnoff_effect(). */
+/* frame_fun of turnoff_effect(). */
 static void
 turnoff_effect_frame (ClutterTimeline * timeline, gint frame,
                       EffectClosure * closure)
@@ -1646,6 +1975,7 @@ turnoff_effect (ClutterTimeline * timeline, ClutterActor * thwin)
   EffectClosure *closure;
 
   closure = new_effect (timeline, thwin,
+                        turnoff_effect_frame, NULL,
                         turnoff_effect_frame,
                         turnoff_effect_complete);
 
@@ -1794,7 +2124,7 @@ show_when_complete (ClutterActor * actor)
 static void
 fade_in_when_complete (ClutterActor * actor, gpointer msecs)
 {
-  if (has_effect (actor, fade_frame))
+  if (has_effect (actor, fade_set))
     /* A fade-out by free_thumb() must be in progress, don't override it. */
     return;
   clutter_actor_set_opacity (actor, 0);
@@ -1854,13 +2184,7 @@ hd_task_navigator_has_unseen_notifications (void)
 gboolean
 hd_task_navigator_has_window (HdTaskNavigator * self, ClutterActor * win)
 {
-  const GList *li;
-  const Thumbnail *thumb;
-
-  for_each_thumbnail (li, thumb)
-    if (thumb->apwin == win)
-      return TRUE;
-  return FALSE;
+  return win && g_hash_table_lookup (Apwins, win) != NULL;
 }
 
 /* Find which thumbnail represents the requested app. */
@@ -2294,15 +2618,23 @@ layout_thumbs (ClutterActor * newborn)
             ? lout.xpos : lout.last_row_xpos;
         }
 
+      /* If @Thumbnails are not changing size and this is not a newborn
+       * the inners of @thumb are already setup, and if it's in the same
+       * cell as before it's been placed as well (or it's flying there).
+       * Only the cells after an added or removed thumbnail change then. */
+      if (oldthsize == Thumbsize && thumb->thwin != newborn
+          && thumb->xcell == xthumb && thumb->ycell == ythumb)
+        goto skip_the_circus;
+
       /* If @thwin's been there, animate as it's moving.  Otherwise if it's
        * a new one to enter the navigator, don't, it's hidden anyway. */
       ops = thumb->thwin == newborn ? &Fly_at_once : &Fly_smoothly;
 
       /* Place @thwin in any case. */
       ops->move (thumb->thwin, xthumb, ythumb);
+      thumb->xcell = xthumb;
+      thumb->ycell = ythumb;
 
-      /* If @Thumbnails are not changing size and this is not a newborn
-       * the inners of @thumb are already setup. */
       if (oldthsize == Thumbsize && thumb->thwin != newborn)
           goto skip_the_circus;
 
@@ -2325,6 +2657,7 @@ layout_thumbs (ClutterActor * newborn)
         {
           gfloat app_geom_fix = 0;
           gfloat wprison_fix = 0;
+          gdouble xscale, yscale;
           gboolean landscape = FALSE;
 
           if(IS_PORTRAIT && !hd_task_navigator_app_portrait_capable(thumb) )
@@ -2352,9 +2685,10 @@ layout_thumbs (ClutterActor * newborn)
               ops->move(thumb->windows, 0, 0);
             }
 
-          ops->scale (thumb->prison,
-                (gdouble)(wprison-wprison_fix) / (appwgw-app_geom_fix),
-                (gdouble)hprison / (appwgh+app_geom_fix));
+          xscale = (gdouble)(wprison-wprison_fix) / (appwgw-app_geom_fix);
+          yscale = (gdouble)hprison / (appwgh+app_geom_fix);
+          ops->scale (thumb->prison, xscale, yscale);
+          set_thumb_scale (thumb, xscale, yscale);
 
           ops->clip (thumb->prison,
                 appwgw,
@@ -2404,7 +2738,9 @@ static void
 reset_thumb_title (Thumbnail * thumb)
 {
   gboolean use_markup;
-  const gchar *new_title;
+  const gchar *new_title, *old_title;
+  const ClutterColor *color;
+  ClutterColor old_color;
 
   /* What to reset the title to? */
   if (thumb_has_notification (thumb))
@@ -2424,9 +2760,22 @@ reset_thumb_title (Thumbnail * thumb)
     }
 
   g_assert (thumb->title != NULL);
-  set_label_text_and_color (thumb->title, new_title,
-                            thumb_has_notification (thumb)
-                              ? &NotificationTextColor : &DefaultTextColor);
+  if (thumb_is_application (thumb))
+    thumb->title_stale = FALSE;
+
+  /* Only redraw .title_image if the title looks different. */
+  color = thumb_has_notification (thumb)
+    ? &NotificationTextColor : &DefaultTextColor;
+  clutter_text_get_color (CLUTTER_TEXT (thumb->title), &old_color);
+  old_title = clutter_text_get_text (CLUTTER_TEXT (thumb->title));
+  if (new_title && old_title && !strcmp (new_title, old_title)
+      && clutter_color_equal (color, &old_color)
+      && !use_markup
+           == !clutter_text_get_use_markup (CLUTTER_TEXT (thumb->title)))
+    return;
+
+  tidy_cached_group_changed (thumb->title_image);
+  set_label_text_and_color (thumb->title, new_title, color);
   clutter_text_set_use_markup (CLUTTER_TEXT(thumb->title), use_markup);
 }
 
@@ -2445,6 +2794,18 @@ create_thwin (Thumbnail * thumb, ClutterActor * prison)
   clutter_actor_set_position (thumb->title,
                               TITLE_LEFT_MARGIN, TITLE_HEIGHT / 2);
 
+  /* .title_image: the text is drawn at full resolution, but the image
+   * has to be remade at the new size when layout_thumbs() resizes it. */
+  thumb->title_image = tidy_cached_group_new ();
+  clutter_actor_set_name (thumb->title_image, "title image");
+  tidy_cached_group_set_use_alpha (thumb->title_image, TRUE);
+  tidy_cached_group_set_downsampling_factor (thumb->title_image, 1);
+  tidy_cached_group_set_render_cache (thumb->title_image, 1);
+  clutter_actor_add_child (thumb->title_image, thumb->title);
+  g_signal_connect_swapped (thumb->title, "notify::allocation",
+                            G_CALLBACK (tidy_cached_group_release_cache),
+                            thumb->title_image);
+
   /* .close, anchored at the top-right corner of the close graphics. */
   thumb->close = clutter_group_new ();
   clutter_actor_set_name (thumb->close, "close area");
@@ -2477,7 +2838,7 @@ create_thwin (Thumbnail * thumb, ClutterActor * prison)
   thumb->plate = clutter_group_new ();
   clutter_actor_set_name (thumb->plate, "plate");
   clutter_container_add (CLUTTER_CONTAINER (thumb->plate),
-                         thumb->title, thumb->close, NULL);
+                         thumb->title_image, thumb->close, NULL);
 
   /* .thwin */
   if (THUMB_DESATURATION_ENABLED)
@@ -2492,6 +2853,24 @@ create_thwin (Thumbnail * thumb, ClutterActor * prison)
   clutter_actor_add_child (CLUTTER_ACTOR (Grid), thumb->thwin);
 }
 
+/* Drops the video screenshot of @apthumb from @Videos unless another
+ * thumbnail of the same application may still show it. */
+static void
+forget_video (Thumbnail * apthumb)
+{
+  GList *li;
+  Thumbnail *other;
+
+  if (!Videos || !apthumb->video_fname)
+    return;
+
+  for_each_appthumb (li, other)
+    if (other != apthumb && other->video_fname
+        && !strcmp (other->video_fname, apthumb->video_fname))
+      return;
+  g_hash_table_remove (Videos, apthumb->video_fname);
+}
+
 /* Release everything related to @thumb.  If you want it can @animate the
  * death of @thumb by a simple fading out. */
 static void
@@ -2518,6 +2897,8 @@ free_thumb (Thumbnail * thumb, gboolean animate)
 
   if (thumb_is_application (thumb))
     {
+      unindex_appthumb (thumb);
+      forget_video (thumb);
       if (thumb->apwin)
         g_object_unref (thumb->apwin);
 
@@ -2545,6 +2926,13 @@ free_thumb (Thumbnail * thumb, gboolean animate)
         mb_wm_object_signal_disconnect (MB_WM_OBJECT (thumb->win),
                                         thumb->win_changed_cb_id);
 
+      if (thumb->refresh_cb)
+        g_source_remove (thumb->refresh_cb);
+      if (thumb->video_req)
+        hd_icon_loader_cancel (thumb->video_req);
+      if (Focus == thumb)
+        Focus = NULL;
+
       g_free(thumb->saved_title);
       if (thumb->nodest)
         XFree (thumb->nodest);
@@ -2576,6 +2964,8 @@ need_to_load_video (Thumbnail * apthumb)
           if (errno != ENOENT)
             g_warning ("%s: %m", apthumb->video_fname);
           clear_video = TRUE;
+          if (Videos)
+            g_hash_table_remove (Videos, apthumb->video_fname);
         }
       else if (sbuf.st_mtime > apthumb->video_mtime)
         {
@@ -2608,6 +2998,393 @@ need_to_load_video (Thumbnail * apthumb)
   return FALSE;
 }
 
+/* Thumbnail images {{{ */
+/* Returns the content generation of the windows of @apthumb,
+ * which changes whenever any of them is damaged. */
+static guint
+thumb_generation (const Thumbnail * apthumb)
+{
+  guint i, generation;
+
+  generation = hd_comp_mgr_get_content_generation (apthumb->apwin);
+  if (apthumb->dialogs)
+    for (i = 0; i < apthumb->dialogs->len; i++)
+      generation += hd_comp_mgr_get_content_generation (
+                                          apthumb->dialogs->pdata[i]);
+  return generation;
+}
+
+/* Have the cached image of @apthumb->windows redrawn now. */
+static void
+refresh_thumb (Thumbnail * apthumb)
+{
+  if (apthumb->refresh_cb)
+    apthumb->refresh_cb = (g_source_remove (apthumb->refresh_cb), 0);
+  apthumb->refreshed = g_get_monotonic_time ();
+  apthumb->generation = thumb_generation (apthumb);
+  tidy_cached_group_changed (apthumb->windows);
+  clutter_actor_queue_redraw (apthumb->windows);
+}
+
+static gboolean
+refresh_thumb_cb (Thumbnail * apthumb)
+{
+  apthumb->refresh_cb = 0;
+  refresh_thumb (apthumb);
+  return FALSE;
+}
+
+/* Returns how many times a second the cached image of @apthumb
+ * may be redrawn at most, or 0 if there's no limit. */
+static gint
+thumb_refresh_rate (const Thumbnail * apthumb)
+{
+  return apthumb == Focus ? THUMB_REFRESH_RATE_FOCUSED : THUMB_REFRESH_RATE;
+}
+
+/* Returns the number of microseconds the cached image of @apthumb
+ * must be shown at least before it's redrawn. */
+static gint64
+thumb_refresh_interval (const Thumbnail * apthumb)
+{
+  gint rate;
+
+  rate = thumb_refresh_rate (apthumb);
+  return rate > 0 ? G_USEC_PER_SEC / rate : 0;
+}
+
+/* Lets the windows of @apthumb update as often as they like again
+ * after hd_task_navigator_window_damaged() has throttled them. */
+static void
+unthrottle_thumb (Thumbnail * apthumb)
+{
+  guint i;
+
+  if (apthumb->apwin)
+    hd_util_throttle_damage (apthumb->apwin, 0);
+  if (apthumb->dialogs)
+    for (i = 0; i < apthumb->dialogs->len; i++)
+      hd_util_throttle_damage (apthumb->dialogs->pdata[i], 0);
+}
+
+/* Called when the contents of @apthumb->windows have changed.  Redraws
+ * the cached image unless it would exceed the refresh budget of @apthumb,
+ * in which case it's redrawn as soon as the budget allows.  If the image
+ * is not used now it's redrawn when it will be. */
+static void
+damage_thumb (Thumbnail * apthumb)
+{
+  gint64 now, due;
+
+  if (!apthumb->cached)
+    {
+      apthumb->generation = 0;
+      return;
+    }
+
+  now = g_get_monotonic_time ();
+  due = apthumb->refreshed + thumb_refresh_interval (apthumb);
+  if (now >= due)
+    refresh_thumb (apthumb);
+  else if (!apthumb->refresh_cb)
+    apthumb->refresh_cb = g_timeout_add ((due - now + 999) / 1000,
+                                         (GSourceFunc)refresh_thumb_cb,
+                                         apthumb);
+}
+
+/* Start painting @apthumb->windows from their cached image,
+ * redrawing it only if the windows have changed since. */
+static void
+cache_thumb (Thumbnail * apthumb)
+{
+  apthumb->cached = TRUE;
+  tidy_cached_group_set_render_cache (apthumb->windows, 1);
+  if (!apthumb->generation
+      || apthumb->generation != thumb_generation (apthumb))
+    refresh_thumb (apthumb);
+}
+
+/* Paint @apthumb->windows directly.  If you want, @release the memory
+ * of the cached image too. */
+static void
+uncache_thumb (Thumbnail * apthumb, gboolean release)
+{
+  apthumb->cached = FALSE;
+  if (apthumb->refresh_cb)
+    apthumb->refresh_cb = (g_source_remove (apthumb->refresh_cb), 0);
+  unthrottle_thumb (apthumb);
+  tidy_cached_group_set_render_cache (apthumb->windows, 0);
+  if (release)
+    {
+      tidy_cached_group_release_cache (apthumb->windows);
+      apthumb->refreshed = 0;
+      apthumb->generation = 0;
+    }
+}
+
+/* Returns roughly how many bytes the cached image of @apthumb takes. */
+static gsize
+thumb_cache_size (const Thumbnail * apthumb)
+{
+  gfloat w, h;
+
+  if (!apthumb->refreshed)
+    return 0;
+  clutter_actor_get_size (apthumb->windows, &w, &h);
+  return (gsize)(w / apthumb->downsample) * (gsize)(h / apthumb->downsample)
+    * 4;
+}
+
+/* Frees the cached images of the thumbnails we don't show which don't
+ * fit in %THUMB_CACHE_KB, keeping the ones shown first when we're
+ * entered, or all of them if memory is low.  Called when we're left
+ * and when the memory becomes low. */
+void
+hd_task_navigator_trim_caches (void)
+{
+  GList *li;
+  Thumbnail *thumb;
+  gsize budget, total, size;
+
+  budget = hd_app_mgr_is_lowmem () ? 0 : 1024 * THUMB_CACHE_KB;
+  total = 0;
+  for_each_appthumb (li, thumb)
+    {
+      if (thumb->cached || !(size = thumb_cache_size (thumb)))
+        continue;
+      if (total + size <= budget)
+        total += size;
+      else
+        uncache_thumb (thumb, TRUE);
+    }
+}
+
+/* Downscale the cached image of @apthumb->windows as much as @prison
+ * is going to be scaled by @xscale and @yscale.  @windows may be rotated
+ * within @prison, so don't lose more detail than the lesser scaling does. */
+static void
+set_thumb_scale (Thumbnail * apthumb, gdouble xscale, gdouble yscale)
+{
+  gfloat downsample;
+
+  downsample = MAX (1, 1 / MAX (xscale, yscale));
+  if (downsample == apthumb->downsample)
+    return;
+
+  /* The texture of the cached image is not resized automatically. */
+  apthumb->downsample = downsample;
+  tidy_cached_group_set_downsampling_factor (apthumb->windows, downsample);
+  tidy_cached_group_release_cache (apthumb->windows);
+  apthumb->refreshed = 0;
+  if (apthumb->cached)
+    refresh_thumb (apthumb);
+}
+
+/*
+ * To be called when @actor, the texture of an application window, has
+ * been damaged while we're active.  If the window is shown in one of our
+ * thumbnails from its cached image, the image is redrawn in due time
+ * and %TRUE is returned, meaning that the caller needn't redraw it.
+ *
+ * The texture has queued a redraw of its own already, which we can't
+ * stop, so the window's damage is throttled to the refresh rate of the
+ * thumbnail too.  Otherwise the switcher would still be repainted as
+ * often as the application updates, only from the same cached image.
+ */
+gboolean
+hd_task_navigator_window_damaged (HdTaskNavigator * self,
+                                  ClutterActor * actor)
+{
+  ClutterActor *windows;
+  Thumbnail *apthumb;
+
+  /* Find the .windows @actor is in. */
+  for (windows = actor; windows; windows = clutter_actor_get_parent (windows))
+    if (TIDY_IS_CACHED_GROUP (windows))
+      break;
+  if (!windows)
+    return FALSE;
+
+  if (!(apthumb = g_hash_table_lookup (Thumb_windows, windows))
+      || !apthumb->cached)
+    return FALSE;
+
+  hd_util_throttle_damage (clutter_actor_get_parent (actor),
+                           thumb_refresh_rate (apthumb));
+  damage_thumb (apthumb);
+  return TRUE;
+}
+/* Thumbnail images }}} */
+
+/* Video screenshots {{{ */
+static void
+free_video_entry (VideoCacheEntry * entry)
+{
+  g_object_unref (entry->pixbuf);
+  g_slice_free (VideoCacheEntry, entry);
+}
+
+static void
+free_video_load (VideoLoad * load)
+{
+  g_slice_free (VideoLoad, load);
+}
+
+/* Shows the video screenshot @pixbuf in @apthumb instead of its
+ * application windows. */
+static void
+set_video (Thumbnail * apthumb, GdkPixbuf * pixbuf)
+{
+  /* Make it appear as if .video were .apwin,
+   * having the same geometry. */
+  g_assert (!apthumb->video);
+  apthumb->video = video_actor (pixbuf,
+                                App_window_geometry_width,
+                                App_window_geometry_height);
+  if (!apthumb->video)
+    return;
+
+  clutter_actor_set_name (apthumb->video, "video");
+  clutter_actor_set_position (apthumb->video, App_window_geometry_x,
+                              App_window_geometry_y);
+  clutter_actor_add_child (CLUTTER_ACTOR (apthumb->prison),
+                           apthumb->video);
+
+  /* Only show @apthumb->video. */
+  uncache_thumb (apthumb, TRUE);
+  clutter_actor_hide (apthumb->windows);
+}
+
+/* #HdIconLoaderFunc for load_video(). */
+static void
+video_loaded (GdkPixbuf * pixbuf, VideoLoad * load)
+{
+  Thumbnail *apthumb = load->apthumb;
+  VideoCacheEntry *entry;
+
+  apthumb->video_req = NULL;
+  if (!pixbuf)
+    return;
+
+  entry = g_slice_new (VideoCacheEntry);
+  entry->pixbuf = g_object_ref (pixbuf);
+  entry->mtime = load->mtime;
+  g_hash_table_insert (Videos, g_strdup (apthumb->video_fname), entry);
+
+  /* Swap it in if it's still what we want to show. */
+  if (hd_task_navigator_is_active () && !apthumb->video
+      && load->mtime == apthumb->video_mtime)
+    set_video (apthumb, pixbuf);
+}
+
+/* Starts loading the version of @apthumb's video screenshot
+ * modified at @mtime into @Videos in the background. */
+static void
+request_video (Thumbnail * apthumb, time_t mtime)
+{
+  VideoLoad *load;
+
+  if (!Videos)
+    Videos = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                    (GDestroyNotify)free_video_entry);
+
+  load = g_slice_new (VideoLoad);
+  load->apthumb = apthumb;
+  load->mtime = mtime;
+  load->width = App_window_geometry_width;
+  load->height = App_window_geometry_height;
+  apthumb->video_req_mtime = mtime;
+  apthumb->video_req = hd_icon_loader_load_with (apthumb->video_fname,
+                                 decode_video,
+                                 (HdIconLoaderFunc)video_loaded, load,
+                                 (GDestroyNotify)free_video_load);
+}
+
+/* Shows @apthumb's video screenshot, which need_to_load_video() said
+ * should be loaded.  It's taken from @Videos if it's there and up to
+ * date, otherwise it's loaded in the background and @apthumb shows
+ * its windows until it's ready. */
+static void
+load_video (Thumbnail * apthumb)
+{
+  VideoCacheEntry *entry;
+
+  entry = Videos ? g_hash_table_lookup (Videos, apthumb->video_fname) : NULL;
+  if (entry && entry->mtime == apthumb->video_mtime)
+    {
+      set_video (apthumb, entry->pixbuf);
+      return;
+    }
+
+  if (apthumb->video_req)
+    {
+      /* Already on its way?  video_loaded() will show it then. */
+      if (apthumb->video_req_mtime == apthumb->video_mtime)
+        return;
+      /* Don't bother with the old one if the file has changed since. */
+      hd_icon_loader_cancel (apthumb->video_req);
+    }
+
+  request_video (apthumb, apthumb->video_mtime);
+}
+/* Video screenshots }}} */
+
+/* Prewarming {{{ */
+/* Loads @apthumb's video screenshot into @Videos unless it's there
+ * already, so claim_win() can show it at once. */
+static void
+prewarm_video (Thumbnail * apthumb)
+{
+  struct stat sbuf;
+  VideoCacheEntry *entry;
+
+  if (!apthumb->video_fname || apthumb->video_req
+      || stat (apthumb->video_fname, &sbuf) < 0)
+    return;
+
+  entry = Videos ? g_hash_table_lookup (Videos, apthumb->video_fname) : NULL;
+  if (!entry || entry->mtime != sbuf.st_mtime)
+    request_video (apthumb, sbuf.st_mtime);
+}
+
+/* Brings everything we can up to date while we're not shown, so that
+ * entering the switcher has less to do than to take the windows. */
+static gboolean
+prewarm (gpointer unused)
+{
+  GList *li;
+  Thumbnail *apthumb;
+
+  Prewarm_cb = 0;
+  if (hd_task_navigator_is_active ())
+    return FALSE;
+
+  for_each_appthumb (li, apthumb)
+    {
+      if (apthumb->title_stale)
+        reset_thumb_title (apthumb);
+      prewarm_video (apthumb);
+    }
+  hd_render_manager_prewarm_blur ();
+
+  return FALSE;
+}
+
+/* Arranges for prewarm() after %PREWARM_DELAY if we're not shown.
+ * It's run with low priority, so only when the main loop is idle. */
+static void
+schedule_prewarm (void)
+{
+  guint delay;
+
+  if (Prewarm_cb || hd_task_navigator_is_active ()
+      || !(delay = PREWARM_DELAY))
+    return;
+  Prewarm_cb = g_timeout_add_full (G_PRIORITY_LOW, delay,
+                                   prewarm, NULL, NULL);
+}
+/* Prewarming }}} */
+
 /* Start managing @apthumb's application window and loads/reloads its
  * last-frame video screenshot if necessary.  Called when we enter
  * the switcher or when a new window is added in switcher view. */
@@ -2641,29 +3418,17 @@ claim_win (Thumbnail * apthumb)
                          (GFunc)clutter_actor_reparent,
                          apthumb->windows);
 
-  /* Load the video screenshot and place its actor in the hierarchy. */
+  /* Load the video screenshot and place its actor in the hierarchy,
+   * now if we have it at hand, otherwise when it's loaded. */
   if (need_to_load_video (apthumb))
-    {
-      /* Make it appear as if .video were .apwin,
-       * having the same geometry. */
-      g_assert (!apthumb->video);
-      apthumb->video = load_image (apthumb->video_fname,
-                                   App_window_geometry_width,
-                                   App_window_geometry_height);
-      if (apthumb->video)
-        {
-          clutter_actor_set_name (apthumb->video, "video");
-          clutter_actor_set_position (apthumb->video, App_window_geometry_x,
-                                      App_window_geometry_y);
-          clutter_actor_add_child (CLUTTER_ACTOR (apthumb->prison),
-                                   apthumb->video);
-        }
-    }
+    load_video (apthumb);
 
   if (!apthumb->video)
-    /* Needn't bother with show_all() the contents of .windows,
-     * they are shown anyway because of reparent(). */
-    clutter_actor_show (apthumb->windows);
+    { /* Needn't bother with show_all() the contents of .windows,
+       * they are shown anyway because of reparent(). */
+      clutter_actor_show (apthumb->windows);
+      cache_thumb (apthumb);
+    }
   else
     /* Only show @apthumb->video. */
     clutter_actor_hide (apthumb->windows);
@@ -2683,8 +3448,9 @@ claim_win (Thumbnail * apthumb)
 /* Stop managing @apthumb's application window and give it back
  * to its original parent. */
 static void
-release_win (const Thumbnail * apthumb)
+release_win (Thumbnail * apthumb)
 {
+  uncache_thumb (apthumb, FALSE);
   hd_render_manager_return_app (apthumb->apwin);
   if (apthumb->cemetery)
     g_ptr_array_foreach (apthumb->cemetery,
@@ -2726,7 +3492,7 @@ adopt_notification (Thumbnail * apthumb, TNote * tnote)
     }
   else
     { /* Make sure all opacities are reset to the normal values. */
-      g_assert (!has_effect (tnote->notwin, fade_frame));
+      g_assert (!has_effect (tnote->notwin, fade_set));
       clutter_actor_hide (apthumb->prison);
       reset_opacity (apthumb->frame.all, 0, FALSE);
       reset_opacity (apthumb->close_notif_icon, 255, TRUE);
@@ -2792,12 +3558,10 @@ orphan_notification (Thumbnail * apthumb, gboolean animate)
 static Thumbnail *
 find_by_apwin (ClutterActor * apwin)
 {
-  GList *li;
   Thumbnail *thumb;
 
-  for_each_appthumb (li, thumb)
-    if (thumb->apwin == apwin)
-      return thumb;
+  if ((thumb = g_hash_table_lookup (Apwins, apwin)) != NULL)
+    return thumb;
 
   g_critical ("find_by_apwin(%p): apwin not found", apwin);
   return NULL;
@@ -2813,32 +3577,26 @@ find_by_apwin (ClutterActor * apwin)
 static Thumbnail *
 find_dialog (guint * idxp, ClutterActor * dialog, gboolean for_removal)
 {
-  GList *li;
   Thumbnail *thumb;
+  guint o;
 
-  for_each_appthumb (li, thumb)
-    {
-      guint o;
+  if (!for_removal && (thumb = g_hash_table_lookup (Apwins, dialog)) != NULL)
+    { /* The dialog will be transient for .apwin. */
+      if (idxp)
+        *idxp = 0;
+      return thumb;
+    }
 
-      if (!for_removal && thumb->apwin == dialog)
-        { /* The dialog will be transient for .apwin. */
+  /* Only the owner's .dialogs need to be searched for the position. */
+  if ((thumb = g_hash_table_lookup (Dialog_owners, dialog)) != NULL)
+    for (o = 0; o < thumb->dialogs->len; o++)
+      if (thumb->dialogs->pdata[o] == dialog)
+        {
           if (idxp)
-            *idxp = 0;
+            *idxp = for_removal ? o : o+1;
           return thumb;
         }
 
-      if (!thumb->dialogs)
-        continue;
-
-      for (o = 0; o < thumb->dialogs->len; o++)
-          if (thumb->dialogs->pdata[o] == dialog)
-            {
-              if (idxp)
-                *idxp = for_removal ? o : o+1;
-              return thumb;
-            }
-    }
-
   if (idxp)
     /* If %NULL the caller was just testing. */
     /* This may not be a bug: some dialogs don't end up in the switcher,
@@ -2846,6 +3604,28 @@ find_dialog (guint * idxp, ClutterActor * dialog, gboolean for_removal)
     g_debug ("couldn't find application for dialog %p", dialog);
   return NULL;
 }
+
+/* Removes @apthumb's windows from @Apwins and @Dialog_owners unless
+ * they have been taken by another thumbnail since. */
+static void
+unindex_appthumb (const Thumbnail * apthumb)
+{
+  guint i;
+
+  if (apthumb->apwin
+      && g_hash_table_lookup (Apwins, apthumb->apwin) == apthumb)
+    g_hash_table_remove (Apwins, apthumb->apwin);
+  if (apthumb->win && g_hash_table_lookup (Xwindows,
+                  GUINT_TO_POINTER (apthumb->win->xwindow)) == apthumb)
+    g_hash_table_remove (Xwindows, GUINT_TO_POINTER (apthumb->win->xwindow));
+  g_hash_table_remove (Thumb_windows, apthumb->windows);
+
+  if (apthumb->dialogs)
+    for (i = 0; i < apthumb->dialogs->len; i++)
+      if (g_hash_table_lookup (Dialog_owners,
+                               apthumb->dialogs->pdata[i]) == apthumb)
+        g_hash_table_remove (Dialog_owners, apthumb->dialogs->pdata[i]);
+}
 /* Managing @Thumbnails }}} */
 
 /* Zooming {{{ */
@@ -2934,6 +3714,9 @@ hd_task_navigator_zoom_in (HdTaskNavigator * self, ClutterActor * win,
   hd_render_manager_unzoom_background ();
   zoom_in (apthumb);
 
+  /* Show the windows in full detail as they grow. */
+  uncache_thumb ((Thumbnail *)apthumb, FALSE);
+
   /* Crossfade .plate with .titlebar. */
   clutter_actor_show (apthumb->titlebar);
   clutter_actor_set_opacity (apthumb->titlebar, 0);
@@ -3011,6 +3794,20 @@ clutter_actor_effect_move(ClutterActor *actor, guint msecs, gfloat x, gfloat y)
   clutter_actor_set_position (actor, x, y);
 }
 
+/* Called when hd_task_navigator_zoom_out() has finished zooming out
+ * of the thumbnail whose .windows is @windows. */
+static void
+zoom_out_complete (ClutterActor * windows)
+{
+  Thumbnail *apthumb;
+
+  if (!hd_task_navigator_is_active ())
+    return;
+  if ((apthumb = g_hash_table_lookup (Thumb_windows, windows)) != NULL
+      && !apthumb->video)
+    cache_thumb (apthumb);
+}
+
 /* Show the navigator and zoom out of @win into it.  @win must have previously
  * been added,  Unless @fun is %NULL @fun(@win, @funparam) is executed when the
  * effect completes. */
@@ -3019,6 +3816,7 @@ hd_task_navigator_zoom_out (HdTaskNavigator * self, ClutterActor * win,
                             ClutterCallback fun, gpointer funparam)
 { g_debug (__FUNCTION__);
   const Thumbnail *apthumb;
+  ClutterTransition *transition;
   gdouble xscale, yscale;
   gfloat yarea, xpos, ypos;
 
@@ -3057,6 +3855,18 @@ hd_task_navigator_zoom_out (HdTaskNavigator * self, ClutterActor * win,
   clutter_actor_effect_scale (Scroller, ZOOM_EFFECT_DURATION, 1, 1);
   clutter_actor_effect_move  (Scroller, ZOOM_EFFECT_DURATION, 0, 0);
 
+  /* Show the live windows while zooming, and switch to the cached image
+   * once we're there.  The user is likely to be interested in that one
+   * most, so let it be refreshed more often. */
+  Focus = apthumb;
+  uncache_thumb ((Thumbnail *)apthumb, FALSE);
+  if ((transition = clutter_actor_get_transition (Scroller, "scale-x")))
+    g_signal_connect_object (transition, "completed",
+                             G_CALLBACK (zoom_out_complete),
+                             apthumb->windows, G_CONNECT_SWAPPED);
+  else
+    zoom_out_complete (apthumb->windows);
+
   /* Crossfade .plate with .titlebar.  (Earlier i said "It's okay to leave
    * .titlebar shown but transparent." but i can't recall why.  Anyway,
    * let's hide it afterwards.) */
@@ -3178,8 +3988,7 @@ appthumb_close_clicked (const Thumbnail * apthumb)
     return TRUE;
 
   if (thumb_has_notification (apthumb))
-    g_signal_emit_by_name (Navigator, "notification-closed",
-                           apthumb->tnote->hdnote);
+    close_tnote (apthumb->tnote);
   else {
     if (!apthumb_has_dialogs (apthumb) 
       && THUMB_DESATURATION_ENABLED)
@@ -3212,8 +4021,15 @@ appthumb_close_touched(ClutterActor *actor, ClutterEvent *event,
 static Bool
 win_title_changed (MBWMClientWindow * win, int unused1, Thumbnail * apthumb)
 {
-  if (!thumb_has_notification (apthumb))
+  if (thumb_has_notification (apthumb))
+    return True;
+
+  /* Applications showing a clock or a progress in their title change it
+   * all the time.  Don't bother with the text until we're shown. */
+  if (hd_task_navigator_is_active ())
     reset_thumb_title (apthumb);
+  else
+    apthumb->title_stale = TRUE;
   return True;
 }
 
@@ -3277,6 +4093,8 @@ create_appthumb (ClutterActor * apwin)
    * of apthumb->win. */
   apthumb->win = actor_to_client_window (apwin, &hmgrc);
   g_assert (apthumb->win != NULL);
+  g_hash_table_insert (Xwindows, GUINT_TO_POINTER (apthumb->win->xwindow),
+                       apthumb);
   apthumb->win_changed_cb_id = mb_wm_object_signal_connect (
                      MB_WM_OBJECT (apthumb->win), MBWM_WINDOW_PROP_NAME,
                      (MBWMObjectCallbackFunc)win_title_changed, apthumb);
@@ -3310,8 +4128,10 @@ create_appthumb (ClutterActor * apwin)
 
   /* Now the actors: .apwin, .titlebar, .windows. */
   apthumb->apwin = g_object_ref (apwin);
+  g_hash_table_insert (Apwins, apwin, apthumb);
   apthumb->titlebar = hd_title_bar_create_fake(SCREEN_WIDTH);
-  apthumb->windows = clutter_group_new ();
+  apthumb->windows = tidy_cached_group_new ();
+  g_hash_table_insert (Thumb_windows, apthumb->windows, apthumb);
   clutter_actor_set_name (apthumb->windows, "windows");
   /* See mb_wm_comp_mgr_clutter_client_actor_reparent_cb - we check this to
    * see if we should linear filter the actor or not */
@@ -3425,12 +4245,11 @@ hd_task_navigator_remove_window (HdTaskNavigator * self,
       return;
     }
 
-  /* Find @apthumb for @win.  We cannot use find_by_apiwin() because
-   * we need @li to be able to remove @apthumb from @Thumbnails. */
-  apthumb = NULL;
-  for_each_appthumb (li, apthumb)
-    if (apthumb->apwin == win)
-      break;
+  /* Find @apthumb for @win.  We don't use find_by_apwin() because
+   * we have a message of our own, and we need @li as well to be able
+   * to remove @apthumb from @Thumbnails. */
+  if ((apthumb = g_hash_table_lookup (Apwins, win)) != NULL)
+    li = g_list_find (Thumbnails, apthumb);
   if (!apthumb)
     { /* Code bloat is your enemy, right? */
       g_critical ("%s: window actor %p not found.  This is most likely "
@@ -3439,6 +4258,10 @@ hd_task_navigator_remove_window (HdTaskNavigator * self,
       return;
     }
 
+  /* @apthumb may outlive its place in @Thumbnails while it's turned off,
+   * but @win can be added again meanwhile. */
+  unindex_appthumb (apthumb);
+
   /*
    * If @win had a notification, add it to @Grid as a standalone thumbnail.
    * TODO It'd be nice to show the notification squeezing but we can't
@@ -3517,6 +4340,8 @@ hd_task_navigator_add_window (HdTaskNavigator * self,
   apthumb = create_appthumb (win);
   if (hd_task_navigator_is_active ())
     claim_win (apthumb);
+  else
+    schedule_prewarm ();
 
   /* Add the @apthumb at the end of application thumbnails. */
   Thumbnails = Notifications
@@ -3542,6 +4367,7 @@ hd_task_navigator_remove_dialog (HdTaskNavigator * self,
   if (!(apthumb = find_dialog (&i, dialog, TRUE)))
     return;
 
+  g_hash_table_remove (Dialog_owners, dialog);
   g_object_unref (dialog);
   g_ptr_array_remove_index (apthumb->dialogs, i);
   if (!apthumb->dialogs->len && !thumb_has_notification (apthumb))
@@ -3549,6 +4375,7 @@ hd_task_navigator_remove_dialog (HdTaskNavigator * self,
 
   if (hd_task_navigator_is_active ())
     hd_render_manager_return_dialog (dialog);
+  damage_thumb (apthumb);
 }
 
 /*
@@ -3585,7 +4412,9 @@ hd_task_navigator_add_dialog (HdTaskNavigator * self,
   if (!apthumb->dialogs)
     apthumb->dialogs = g_ptr_array_new ();
   g_ptr_array_add (apthumb->dialogs, g_object_ref(dialog));
+  g_hash_table_insert (Dialog_owners, dialog, apthumb);
   clutter_actor_hide (apthumb->close_app_icon);
+  damage_thumb (apthumb);
 
   /* Undo desaturation for @apthumb->thwin. */
   if (THUMB_DESATURATION_ENABLED)
@@ -3614,6 +4443,7 @@ hd_task_navigator_hibernate_window (HdTaskNavigator * self,
   apthumb->title_had_markup = apthumb->win->name_has_markup;
 
   /* Release .win. */
+  g_hash_table_remove (Xwindows, GUINT_TO_POINTER (apthumb->win->xwindow));
   mb_wm_object_signal_disconnect (MB_WM_OBJECT (apthumb->win),
                                   apthumb->win_changed_cb_id);
   apthumb->win = NULL;
@@ -3660,18 +4490,27 @@ hd_task_navigator_replace_window (HdTaskNavigator * self,
   showing = hd_task_navigator_is_active ();
   if (showing) /* .apwin is in the cemetery */
     clutter_actor_hide (apthumb->apwin);
+  g_hash_table_remove (Apwins, apthumb->apwin);
   g_object_unref (apthumb->apwin);
   apthumb->apwin = g_object_ref (new_win);
+  g_hash_table_insert (Apwins, new_win, apthumb);
   if (showing)
     clutter_actor_reparent (apthumb->apwin, apthumb->windows);
+  damage_thumb (apthumb);
 
   /* Replace the client window structure with @new_win's. */
   if (apthumb->win)
-    mb_wm_object_signal_disconnect (MB_WM_OBJECT (apthumb->win),
-                                    apthumb->win_changed_cb_id);
+    {
+      g_hash_table_remove (Xwindows,
+                           GUINT_TO_POINTER (apthumb->win->xwindow));
+      mb_wm_object_signal_disconnect (MB_WM_OBJECT (apthumb->win),
+                                      apthumb->win_changed_cb_id);
+    }
   apthumb->win = actor_to_client_window (new_win, NULL);
   if (apthumb->win)
     {
+      g_hash_table_insert (Xwindows,
+                           GUINT_TO_POINTER (apthumb->win->xwindow), apthumb);
       g_free (apthumb->saved_title);
       apthumb->saved_title = NULL;
       apthumb->win_changed_cb_id = mb_wm_object_signal_connect (
@@ -3801,6 +4640,35 @@ numstrcmp(const gchar * a, const gchar * b)
     }
 }
 
+/* Returns how many notifications an %HdNote stands for. */
+static guint
+note_count (HdNote * hdnote)
+{
+  const char *count;
+  guint n;
+
+  count = hd_note_get_count (hdnote);
+  n = count ? g_ascii_strtoull (count, NULL, 10) : 0;
+  return MAX (n, 1);
+}
+
+/* Returns what @tnote's .count should display: the count of .hdnote,
+ * or the total of the thread if it has .older notifications. */
+static gchar *
+tnote_count (const TNote * tnote)
+{
+  const GList *li;
+  guint count;
+
+  if (!tnote->older)
+    return g_strdup (hd_note_get_count (tnote->hdnote));
+
+  count = note_count (tnote->hdnote);
+  for (li = tnote->older; li; li = li->next)
+    count += note_count (li->data);
+  return g_strdup_printf ("%u", count);
+}
+
 /* HdNote::HdNoteSignalChanged signal handler. */
 static Bool
 tnote_changed (HdNote * hdnote, int unused1, TNote * tnote)
@@ -3808,6 +4676,7 @@ tnote_changed (HdNote * hdnote, int unused1, TNote * tnote)
   GList *li;
   Thumbnail *thumb;
   gboolean is_more;
+  gchar *count;
   const char *iname, *oname;
 
   for_each_thumbnail (li, thumb)
@@ -3815,14 +4684,14 @@ tnote_changed (HdNote * hdnote, int unused1, TNote * tnote)
       break;
   g_assert (thumb != NULL);
 
+  count = tnote_count (tnote);
   is_more = numstrcmp (clutter_text_get_text (CLUTTER_TEXT (tnote->count)),
-                       hd_note_get_count (tnote->hdnote)) < 0;
+                       count) < 0;
   set_label_text_and_color (tnote->time,
                             hd_note_get_time (tnote->hdnote),
                             NULL);
-  set_label_text_and_color (tnote->count,
-                            hd_note_get_count (tnote->hdnote),
-                            NULL);
+  set_label_text_and_color (tnote->count, count, NULL);
+  g_free (count);
   set_label_text_and_color (tnote->message,
                             hd_note_get_message (tnote->hdnote),
                             NULL);
@@ -3918,6 +4787,20 @@ create_tnote (HdNote * hdnote)
   return tnote;
 }
 
+/* Makes @tnote show @hdnote instead of its current .hdnote, taking over
+ * the caller's reference of it.  The old .hdnote is left to the caller. */
+static void
+tnote_show (TNote * tnote, HdNote * hdnote)
+{
+  mb_wm_object_signal_disconnect (MB_WM_OBJECT (tnote->hdnote),
+                                  tnote->hdnote_changed_cb_id);
+  tnote->hdnote = hdnote;
+  tnote->hdnote_changed_cb_id = mb_wm_object_signal_connect (
+                        MB_WM_OBJECT (hdnote), HdNoteSignalChanged,
+                        (MBWMObjectCallbackFunc)tnote_changed, tnote);
+  tnote_changed (hdnote, 0, tnote);
+}
+
 /* Releases what was allocated by create_tnote() except the #ClutterActors,
  * which are taken care of by free_thumb(). */
 static void
@@ -3926,10 +4809,29 @@ free_tnote (TNote * tnote)
   mb_wm_object_signal_disconnect (MB_WM_OBJECT (tnote->hdnote),
                                   tnote->hdnote_changed_cb_id);
   mb_wm_object_unref (MB_WM_OBJECT (tnote->hdnote));
+  g_list_foreach (tnote->older, (GFunc)mb_wm_object_unref, NULL);
+  g_list_free (tnote->older);
   g_object_unref (tnote->notwin);
   g_free (tnote);
 }
 
+/* Asks for closing all notifications of @tnote's thread. */
+static void
+close_tnote (const TNote * tnote)
+{
+  GList *notes, *li;
+
+  /* Closing may change .older under us. */
+  notes = g_list_prepend (g_list_copy (tnote->older), tnote->hdnote);
+  g_list_foreach (notes, (GFunc)mb_wm_object_ref, NULL);
+  for (li = notes; li; li = li->next)
+    {
+      g_signal_emit_by_name (Navigator, "notification-closed", li->data);
+      mb_wm_object_unref (li->data);
+    }
+  g_list_free (notes);
+}
+
 /* Returns whether the notification represented by @tnote belongs to
  * the application represented by @thumb. */
 static gboolean
@@ -3938,6 +4840,33 @@ tnote_matches_thumb (const TNote * tnote, const Thumbnail * thumb)
   char const * dest = hd_note_get_destination (tnote->hdnote);
   return dest && thumb->nodest && !strcmp (dest, thumb->nodest);
 }
+
+/* Returns the %Thumbnail showing a notification of the same thread as
+ * @hdnote, if any, either on its own or in an application's title area.
+ * The thread is what the sender tells in the _HILDON_NOTIFICATION_THREAD
+ * property of the notification, like a conversation.  The destination
+ * is only the application, which may have many threads, so it must
+ * match too but it doesn't make a thread by itself. */
+static Thumbnail *
+find_by_thread (HdNote * hdnote)
+{
+  GList *li;
+  Thumbnail *thumb;
+  const char *thread, *dest, *str;
+
+  if (!(thread = hd_note_get_thread (hdnote))
+      || !(dest = hd_note_get_destination (hdnote)))
+    return NULL;
+
+  for_each_thumbnail (li, thumb)
+    if (thumb->tnote
+        && (str = hd_note_get_thread (thumb->tnote->hdnote)) != NULL
+        && !strcmp (str, thread)
+        && (str = hd_note_get_destination (thumb->tnote->hdnote)) != NULL
+        && !strcmp (str, dest))
+      return thumb;
+  return NULL;
+}
 /* %TNote:s }}} */
 
 /* nothumb:s {{{ */
@@ -3962,8 +4891,7 @@ nothumb_close_clicked (Thumbnail * nothumb)
   if (!STATE_IS_TASK_NAV(hd_render_manager_get_state ()))
     /* Be consistent with appthumb_clicked(). */
     return TRUE;
-  g_signal_emit_by_name (Navigator, "notification-closed",
-                         nothumb->tnote->hdnote);
+  close_tnote (nothumb->tnote);
   return TRUE;
 }
 
@@ -4055,6 +4983,19 @@ hd_task_navigator_add_notification (HdTaskNavigator * self,
   hd_title_bar_set_switcher_pulse (
                HD_TITLE_BAR (hd_render_manager_get_title_bar ()), TRUE);
 
+  /* Do we show a notification of the same thread already?  Then @hdnote
+   * takes its place and the older ones are only counted from now on,
+   * so a busy thread doesn't fill the @Grid with thumbnails. */
+  if ((apthumb = find_by_thread (hdnote)) != NULL)
+    {
+      tnote = apthumb->tnote;
+      tnote->older = g_list_prepend (tnote->older, tnote->hdnote);
+      mb_wm_object_ref (MB_WM_OBJECT (hdnote));
+      tnote_show (tnote, hdnote);
+      UnseenNotifications = TRUE;
+      return;
+    }
+
   /* Is @hdnote's destination application already open? */
   tnote = create_tnote (hdnote);
   for_each_appthumb (li, apthumb)
@@ -4090,19 +5031,41 @@ void
 hd_task_navigator_remove_notification (HdTaskNavigator * self,
                                        HdNote * hdnote)
 { g_debug (__FUNCTION__);
-  GList *li;
+  GList *li, *older;
+  TNote *tnote;
   Thumbnail *thumb;
 
   g_return_if_fail (hdnote != NULL);
 
   /* Find @thumb for @hdnote. */
+  older = NULL;
   for_each_thumbnail (li, thumb)
-    if (thumb->tnote && thumb->tnote->hdnote == hdnote)
+    if (thumb->tnote && (thumb->tnote->hdnote == hdnote
+          || (older = g_list_find (thumb->tnote->older, hdnote)) != NULL))
       break;
   if (!thumb || !thumb->tnote)
     /* This would be a bug somewhere, but who cares. */
     return;
 
+  tnote = thumb->tnote;
+  if (older)
+    { /* Only the count of the thread changes. */
+      tnote->older = g_list_delete_link (tnote->older, older);
+      mb_wm_object_unref (MB_WM_OBJECT (hdnote));
+      tnote_changed (tnote->hdnote, 0, tnote);
+      return;
+    }
+  else if (tnote->older)
+    { /* Show the next newest notification of the thread instead. */
+      HdNote *next;
+
+      next = tnote->older->data;
+      tnote->older = g_list_delete_link (tnote->older, tnote->older);
+      tnote_show (tnote, next);
+      mb_wm_object_unref (MB_WM_OBJECT (hdnote));
+      return;
+    }
+
   if (thumb_is_notification (thumb))
     { /* @hdinfo is displayed in a thumbnail on its own. */
       remove_nothumb (li, TRUE);
@@ -4218,10 +5181,20 @@ navigator_shown (ClutterActor * navigator, gpointer unused)
   clutter_actor_set_scale (Scroller, 1, 1);
   clutter_actor_set_position (Scroller, 0, 0);
 
+  if (Prewarm_cb)
+    {
+      g_source_remove (Prewarm_cb);
+      Prewarm_cb = 0;
+    }
+
   /* Take all application windows we know about into our care
    * because we are responsible for showing them now. */
   for_each_appthumb (li, thumb)
-    claim_win (thumb);
+    {
+      claim_win (thumb);
+      if (thumb->title_stale)
+        reset_thumb_title (thumb);
+    }
 
   /* Because we're just about to show them */
   UnseenNotifications = FALSE;
@@ -4252,6 +5225,12 @@ navigator_hidden (ClutterActor * navigator, gpointer unused)
   /* Undo navigator_shown(). */
   for_each_appthumb (li, thumb)
     release_win (thumb);
+  hd_task_navigator_trim_caches ();
+  Focus = NULL;
+
+  /* The application in the foreground may have changed
+   * its screenshot by the time we're entered again. */
+  schedule_prewarm ();
 }
 /* Entering and exiting @Navigator }}} */
 
@@ -4413,6 +5392,10 @@ hd_task_navigator_init (HdTaskNavigator * self)
 {
   Navigator = CLUTTER_ACTOR (self);
   clutter_actor_set_reactive (Navigator, TRUE);
+  Apwins = g_hash_table_new (NULL, NULL);
+  Dialog_owners = g_hash_table_new (NULL, NULL);
+  Xwindows = g_hash_table_new (NULL, NULL);
+  Thumb_windows = g_hash_table_new (NULL, NULL);
   clutter_actor_set_size (Navigator, SCREEN_WIDTH, SCREEN_HEIGHT);
   g_signal_connect (Navigator, "show", G_CALLBACK (navigator_shown),  NULL);
   g_signal_connect (Navigator, "hide", G_CALLBACK (navigator_hidden), NULL);
@@ -4712,13 +5695,7 @@ hd_task_navigator_app_portrait_capable(Thumbnail * thumb)
 static Thumbnail *
 find_thumb_from_xwindow(Window xwindow)
 {
-  const GList *li;
-  Thumbnail * thumb;
-
-  for (li = Thumbnails; li && (thumb = li->data); li = li->next)
-    if(thumb->win && thumb->win->xwindow == xwindow)
-      return thumb;
-  return NULL;
+  return g_hash_table_lookup (Xwindows, GUINT_TO_POINTER (xwindow));
 }
 
 
@@ -4769,6 +5746,9 @@ hd_task_navigator_update_win_orientation (Window xwindow, gboolean portrait)
           ops->scale (thumb->prison,
               (gdouble)wprison / appwgw,
               (gdouble)hprison / appwgh);
+          set_thumb_scale (thumb,
+              (gdouble)wprison / appwgw,
+              (gdouble)hprison / appwgh);
         }
       else
         {
@@ -4782,6 +5762,9 @@ hd_task_navigator_update_win_orientation (Window xwindow, gboolean portrait)
           ops->scale (thumb->prison,
                 (gdouble)wprison / (appwgw-adj),
                 (gdouble)hprison / (appwgh+adj));
+          set_thumb_scale (thumb,
+                (gdouble)wprison / (appwgw-adj),
+                (gdouble)hprison / (appwgh+adj));
         }
 
       layout_thumbs (thumb->thwin);
@@ -50,6 +50,8 @@ void hd_task_navigator_zoom_out  (HdTaskNavigator *self,
                                   gpointer funparam);
 
 void hd_task_navigator_transition_done  (HdTaskNavigator *self);
+gboolean hd_task_navigator_window_damaged (HdTaskNavigator *self,
+                                           ClutterActor *actor);
 
 void hd_task_navigator_add_window       (HdTaskNavigator *self,
                                          ClutterActor *win);
@@ -80,6 +82,7 @@ void hd_task_navigator_remove_notification (HdTaskNavigator *self,
 void hd_task_navigator_activate(int x, int y, int close);
 
 void hd_task_navigator_sort_thumbs(void);
+void hd_task_navigator_trim_caches (void);
 void hd_task_navigator_rotate_thumbs(void);
 
 /* FIXME: not used anymore. */
@@ -48,6 +48,7 @@
 #include "hd-launcher-tree.h"
 #include "home/hd-render-manager.h"
 #include "home/hd-home-view-container.h"
+#include "home/hd-task-navigator.h"
 #include "hd-transition.h"
 #include "hd-wm.h"
 #include "hd-orientation-lock.h"
@@ -1609,6 +1610,13 @@ hd_app_mgr_can_launch (HdLauncherApp *launcher)
   return !priv->lowmem;
 }
 
+/* Whether the system has told us that the memory is low. */
+gboolean
+hd_app_mgr_is_lowmem (void)
+{
+  return HD_APP_MGR_GET_PRIVATE (hd_app_mgr_get ())->lowmem;
+}
+
 static gboolean hd_app_mgr_can_prestart (HdLauncherApp *launcher)
 {
   HdAppMgrPrivate *priv = HD_APP_MGR_GET_PRIVATE (hd_app_mgr_get ());
@@ -2056,7 +2064,10 @@ hd_app_mgr_dbus_signal_handler (DBusConnection *conn,
   if (dbus_message_is_signal (msg,
                               LOWMEM_ON_SIGNAL_INTERFACE,
                               LOWMEM_ON_SIGNAL_NAME))
-    priv->lowmem = TRUE;
+    {
+      priv->lowmem = TRUE;
+      hd_task_navigator_trim_caches ();
+    }
   else if (dbus_message_is_signal (msg,
                                    LOWMEM_OFF_SIGNAL_INTERFACE,
                                    LOWMEM_OFF_SIGNAL_NAME))
@@ -116,6 +116,7 @@ extern gboolean conf_dbus_ctrl_shortcuts;
 extern gint conf_ctrl_backspace_in_tasknav;
 extern gboolean conf_disable_edit;
 gboolean hd_app_mgr_is_portrait(void);
+gboolean hd_app_mgr_is_lowmem (void);
 gboolean hd_app_mgr_slide_is_open (void);
 gboolean hd_app_mgr_ui_can_rotate (void);
 void hd_app_mgr_update_orientation(void);
@@ -89,6 +89,13 @@ struct _HdLauncherGridPrivate
   /* an internal status indicating how to relayout the grid (which usually is
    * the same of the real device orientation, but may not be in sync with it) */
   gboolean is_portrait;
+
+  /* Whether the tiles are where hd_launcher_grid_layout() would put them,
+   * and how many visible tiles and what orientation it was done for.
+   * Adding, removing, showing or hiding a tile invalidates it. */
+  gboolean layout_valid;
+  gboolean laid_out_portrait;
+  guint laid_out_tiles;
 };
 
 enum
@@ -337,6 +344,15 @@ tidy_scrollable_iface_init (TidyScrollableInterface *iface)
   iface->get_adjustments = hd_launcher_grid_get_adjustments;
 }
 
+/* Hiding or showing a tile moves the ones after it. */
+static void
+hd_launcher_grid_tile_visibility_changed (ClutterActor   *tile,
+                                          GParamSpec     *pspec,
+                                          HdLauncherGrid *grid)
+{
+  grid->priv->layout_valid = FALSE;
+}
+
 static void
 hd_launcher_grid_actor_added (ClutterContainer *container,
                               ClutterActor     *actor)
@@ -348,6 +364,10 @@ hd_launcher_grid_actor_added (ClutterContainer *container,
   if (HD_IS_LAUNCHER_TILE(actor))
     {
       priv->tiles = g_list_append (priv->tiles, g_object_ref(actor));
+      priv->layout_valid = FALSE;
+      g_signal_connect_object (actor, "notify::visible",
+                        G_CALLBACK (hd_launcher_grid_tile_visibility_changed),
+                        container, 0);
 
       /* relayout moved to the traversal code */
     }
@@ -366,6 +386,9 @@ hd_launcher_grid_actor_removed (ClutterContainer *container,
   if (HD_IS_LAUNCHER_TILE(actor))
     {
       priv->tiles = g_list_remove (priv->tiles, actor);
+      priv->layout_valid = FALSE;
+      g_signal_handlers_disconnect_by_func (actor,
+                        hd_launcher_grid_tile_visibility_changed, container);
       g_object_unref(actor);
 
       /* relayout moved to the traversal code */
@@ -484,6 +507,19 @@ void hd_launcher_grid_layout (HdLauncherGrid *grid)
   GList *l;
   guint cur_height, n_visible_launchers, n_rows;
 
+  _hd_launcher_grid_count_children_and_rows (grid,
+      &n_visible_launchers, &n_rows);
+
+  /* Rotating back and forth or re-laying out every page on a tree change
+   * shouldn't make us move every tile and rebuild the blockers again. */
+  if (priv->layout_valid
+      && priv->laid_out_portrait == hd_launcher_grid_is_portrait (grid)
+      && priv->laid_out_tiles == n_visible_launchers)
+    return;
+  priv->layout_valid = TRUE;
+  priv->laid_out_portrait = hd_launcher_grid_is_portrait (grid);
+  priv->laid_out_tiles = n_visible_launchers;
+
   /* Free our list of 'blocker' actors that we use to block mouse clicks.
    * TODO: just check we have 'nrows' worth */
   g_list_foreach(priv->blockers,
@@ -492,9 +528,6 @@ void hd_launcher_grid_layout (HdLauncherGrid *grid)
   g_list_free(priv->blockers);
   priv->blockers = NULL;
 
-  _hd_launcher_grid_count_children_and_rows (grid,
-      &n_visible_launchers, &n_rows);
-
   if (hd_launcher_grid_is_portrait (grid))
     cur_height = HD_LAUNCHER_PAGE_XMARGIN;
   else
@@ -759,6 +792,41 @@ hd_launcher_grid_clear (HdLauncherGrid *grid)
     }
 }
 
+/* Returns the tiles of @grid in the order they are laid out.
+ * The list is owned by @grid. */
+GList *
+hd_launcher_grid_get_tiles (HdLauncherGrid *grid)
+{
+  g_return_val_if_fail (HD_IS_LAUNCHER_GRID (grid), NULL);
+
+  return grid->priv->tiles;
+}
+
+/* Lays out the tiles of @grid in the order of @tiles from now on,
+ * which must have the same tiles as hd_launcher_grid_get_tiles(). */
+void
+hd_launcher_grid_set_tile_order (HdLauncherGrid *grid, GList *tiles)
+{
+  HdLauncherGridPrivate *priv;
+  GList *l, *t;
+
+  g_return_if_fail (HD_IS_LAUNCHER_GRID (grid));
+
+  priv = grid->priv;
+  g_return_if_fail (g_list_length (tiles) == g_list_length (priv->tiles));
+
+  for (l = priv->tiles, t = tiles; l; l = l->next, t = t->next)
+    if (l->data != t->data)
+      break;
+  if (!l)
+    return;
+
+  /* The list holds a reference on each tile, keep them. */
+  for (l = priv->tiles, t = tiles; l; l = l->next, t = t->next)
+    l->data = t->data;
+  priv->layout_valid = FALSE;
+}
+
 /* Reset the grid before it is shown */
 void
 hd_launcher_grid_reset(HdLauncherGrid *grid, gboolean hard)
@@ -984,6 +1052,33 @@ hd_launcher_grid_transition(HdLauncherGrid *grid,
     }
 }
 
+/* Puts the tiles back the way they are when no transition is going on,
+ * as hd_launcher_grid_transition() may have left them half-way. */
+void
+hd_launcher_grid_transition_settle(HdLauncherGrid *grid)
+{
+  GList *l;
+
+  g_return_if_fail (HD_IS_LAUNCHER_GRID (grid));
+
+  for (l = grid->priv->tiles; l; l = l->next)
+    {
+      HdLauncherTile *tile;
+      ClutterActor *tile_icon, *tile_label;
+
+      if (!HD_IS_LAUNCHER_TILE (l->data))
+        continue;
+      tile = HD_LAUNCHER_TILE (l->data);
+
+      clutter_actor_set_depth (CLUTTER_ACTOR (tile), 0);
+      clutter_actor_set_opacity (CLUTTER_ACTOR (tile), 255);
+      if ((tile_icon = hd_launcher_tile_get_icon (tile)) != NULL)
+        clutter_actor_set_opacity (tile_icon, 255);
+      if ((tile_label = hd_launcher_tile_get_label (tile)) != NULL)
+        clutter_actor_set_opacity (tile_label, 255);
+    }
+}
+
 static gboolean
 _hd_launcher_grid_blocker_release_cb (ClutterActor *actor,
                                       ClutterButtonEvent *event,
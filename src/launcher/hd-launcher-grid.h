@@ -65,6 +65,9 @@ GType         hd_launcher_grid_get_type (void) G_GNUC_CONST;
 ClutterActor *hd_launcher_grid_new      (void);
 
 void          hd_launcher_grid_clear    (HdLauncherGrid *grid);
+GList        *hd_launcher_grid_get_tiles (HdLauncherGrid *grid);
+void          hd_launcher_grid_set_tile_order (HdLauncherGrid *grid,
+                                               GList          *tiles);
 void          hd_launcher_grid_reset_v_adjustment (HdLauncherGrid *grid);
 
 void          hd_launcher_grid_transition_begin(HdLauncherGrid *grid,
@@ -74,6 +77,7 @@ void          hd_launcher_grid_transition(HdLauncherGrid *grid,
                                           HdLauncherPage *page,
                                           HdLauncherPageTransition trans_type,
                                           float amount);
+void          hd_launcher_grid_transition_settle(HdLauncherGrid *grid);
 void          hd_launcher_grid_reset(HdLauncherGrid *grid, gboolean hard);
 void          hd_launcher_grid_layout(HdLauncherGrid *grid);
 void          hd_launcher_grid_relayout (HdLauncherGrid *grid);
@@ -33,6 +33,7 @@
 #include <tidy/tidy-scroll-view.h>
 #include <tidy/tidy-scroll-bar.h>
 #include <tidy/tidy-adjustment.h>
+#include <tidy/tidy-cached-group.h>
 #include <hildon/hildon-defines.h>
 #include <math.h>
 
@@ -63,8 +64,14 @@ struct _HdLauncherPagePrivate
   ClutterActor *grid;
   ClutterActor *empty_label;
 
+  /* Holds the scroller.  During the transitions which move all the tiles
+   * together it renders them once and we animate the result instead. */
+  ClutterActor *cache;
+
   HdLauncherPageTransition transition_type;
   ClutterTimeline *transition;
+  gboolean transition_cached;
+  gint transition_depth;
 
   /* When the user clicks and drags more than a certain amount, we want
    * to deselect what they had clicked on - so we must keep track of
@@ -97,6 +104,10 @@ static void hd_launcher_page_new_frame(ClutterTimeline *timeline,
                                        gint msecs, gpointer data);
 static void hd_launcher_page_transition_end(ClutterTimeline *timeline,
                                             gpointer data);
+static gboolean hd_launcher_page_transition_is_uniform (
+                                  HdLauncherPageTransition trans_type);
+static void hd_launcher_page_cached_transition (HdLauncherPage *page,
+                                                float amount);
 
 static void
 hd_launcher_page_class_init (HdLauncherPageClass *klass)
@@ -233,8 +244,13 @@ hd_launcher_page_constructed (GObject *object)
   clutter_actor_add_child (CLUTTER_ACTOR (page), priv->empty_label);
   g_free (font_string);
 
+  priv->cache = tidy_cached_group_new ();
+  tidy_cached_group_set_use_alpha (priv->cache, TRUE);
+  tidy_cached_group_set_downsampling_factor (priv->cache, 1);
+  clutter_actor_add_child (CLUTTER_ACTOR (page), priv->cache);
+
   priv->scroller = tidy_finger_scroll_new (TIDY_FINGER_SCROLL_MODE_KINETIC);
-  clutter_actor_add_child (CLUTTER_ACTOR (page), priv->scroller);
+  clutter_actor_add_child (priv->cache, priv->scroller);
   clutter_actor_set_size(priv->scroller, page_width, page_height);
 
   priv->grid = hd_launcher_grid_new ();
@@ -393,6 +409,22 @@ void hd_launcher_page_transition(HdLauncherPage *page, HdLauncherPageTransition
 
   hd_launcher_grid_transition_begin(HD_LAUNCHER_GRID(priv->grid), trans_type);
 
+  /* If all the tiles would move the same way, move a picture of them. */
+  priv->transition_cached =
+    hd_launcher_page_transition_is_uniform (trans_type)
+    && hd_transition_get_int (
+                hd_launcher_page_get_transition_string (trans_type),
+                "cached", 1);
+  if (priv->transition_cached)
+    {
+      priv->transition_depth = hd_transition_get_int (
+                hd_launcher_page_get_transition_string (trans_type),
+                "depth", 100);
+      hd_launcher_grid_transition_settle (HD_LAUNCHER_GRID (priv->grid));
+      tidy_cached_group_changed (priv->cache);
+      tidy_cached_group_set_render_cache (priv->cache, 1);
+    }
+
   priv->transition = clutter_timeline_new(
       hd_transition_get_int(
                 hd_launcher_page_get_transition_string(priv->transition_type),
@@ -439,10 +471,13 @@ hd_launcher_page_new_frame(ClutterTimeline *timeline,
   duration = clutter_timeline_get_duration(timeline);
   amt = (float)msecs / (float)duration;
 
-  hd_launcher_grid_transition(HD_LAUNCHER_GRID(priv->grid),
-                              page,
-                              priv->transition_type,
-                              amt);
+  if (priv->transition_cached)
+    hd_launcher_page_cached_transition (page, amt);
+  else
+    hd_launcher_grid_transition(HD_LAUNCHER_GRID(priv->grid),
+                                page,
+                                priv->transition_type,
+                                amt);
 
     switch (priv->transition_type)
       {
@@ -478,10 +513,20 @@ hd_launcher_page_transition_end(ClutterTimeline *timeline,
     priv->transition = 0;
   }
 
-  hd_launcher_grid_transition(HD_LAUNCHER_GRID(priv->grid),
-                              page,
-                              priv->transition_type,
-                              1.0f);
+  if (priv->transition_cached)
+    {
+      /* The tiles are already settled, just show them again. */
+      tidy_cached_group_set_render_cache (priv->cache, 0);
+      tidy_cached_group_release_cache (priv->cache);
+      tidy_cached_group_set_cache_opacity (priv->cache, 255);
+      clutter_actor_set_depth (priv->cache, 0);
+      priv->transition_cached = FALSE;
+    }
+  else
+    hd_launcher_grid_transition(HD_LAUNCHER_GRID(priv->grid),
+                                page,
+                                priv->transition_type,
+                                1.0f);
   hd_launcher_grid_transition_end(HD_LAUNCHER_GRID(priv->grid));
 
   switch (priv->transition_type) {
@@ -507,6 +552,66 @@ hd_launcher_page_transition_end(ClutterTimeline *timeline,
   }
 }
 
+/* Whether hd_launcher_grid_transition() would do the same to every tile
+ * for @trans_type, so we can do it to all of them at once. */
+static gboolean
+hd_launcher_page_transition_is_uniform (HdLauncherPageTransition trans_type)
+{
+  switch (trans_type)
+    {
+    case HD_LAUNCHER_PAGE_TRANSITION_IN:
+    case HD_LAUNCHER_PAGE_TRANSITION_IN_SUB:
+      return !hd_transition_get_int (
+                  hd_launcher_page_get_transition_string (trans_type),
+                  "sequenced", 0);
+    case HD_LAUNCHER_PAGE_TRANSITION_OUT:
+    case HD_LAUNCHER_PAGE_TRANSITION_OUT_SUB:
+    case HD_LAUNCHER_PAGE_TRANSITION_BACK:
+    case HD_LAUNCHER_PAGE_TRANSITION_FORWARD:
+      return TRUE;
+    case HD_LAUNCHER_PAGE_TRANSITION_OUT_BACK:
+    case HD_LAUNCHER_PAGE_TRANSITION_LAUNCH:
+      break;
+    }
+  return FALSE;
+}
+
+/* The same as hd_launcher_grid_transition(), but for the cached image
+ * of all the tiles. */
+static void
+hd_launcher_page_cached_transition (HdLauncherPage *page, float amount)
+{
+  HdLauncherPagePrivate *priv = HD_LAUNCHER_PAGE_GET_PRIVATE (page);
+  float depth, opacity;
+
+  switch (priv->transition_type)
+    {
+    case HD_LAUNCHER_PAGE_TRANSITION_IN:
+    case HD_LAUNCHER_PAGE_TRANSITION_IN_SUB:
+      depth = priv->transition_depth * (1 - amount);
+      opacity = amount;
+      break;
+    case HD_LAUNCHER_PAGE_TRANSITION_OUT:
+    case HD_LAUNCHER_PAGE_TRANSITION_OUT_SUB:
+      depth = priv->transition_depth * amount;
+      opacity = 1 - amount;
+      break;
+    case HD_LAUNCHER_PAGE_TRANSITION_BACK:
+      depth = -priv->transition_depth * amount;
+      opacity = 1 - amount;
+      break;
+    case HD_LAUNCHER_PAGE_TRANSITION_FORWARD:
+      depth = -priv->transition_depth * (1 - amount);
+      opacity = amount;
+      break;
+    default:
+      return;
+    }
+
+  clutter_actor_set_depth (priv->cache, depth);
+  tidy_cached_group_set_cache_opacity (priv->cache, (int)(opacity * 255));
+}
+
 gfloat hd_launcher_page_get_scroll_y(HdLauncherPage *page)
 {
   HdLauncherPagePrivate *priv;
@@ -0,0 +1,409 @@
+/*
+ * This file is part of hildon-desktop
+ *
+ * Copyright (C) 2009 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "hd-launcher-search.h"
+
+/*
+ * The index is a sorted array of (word, item) pairs, so finding the
+ * words starting with a prefix is a binary search and a short scan,
+ * whatever the number of applications.  Words are accent-folded and
+ * case-folded, both when indexing and when querying.
+ */
+typedef struct
+{
+  gchar *word;
+  GQuark id;
+} Entry;
+
+/* An application in the index.  @text is what we have taken the words
+ * from, so we can tell whether a new version of the item needs to be
+ * reindexed. */
+typedef struct
+{
+  HdLauncherItem *item;
+  gchar *text;
+} Indexed;
+
+struct _HdLauncherSearch
+{
+  /* of #Entry, sorted by word */
+  GArray *entries;
+  /* id quark -> #Indexed */
+  GHashTable *items;
+};
+
+static gchar *fold (const gchar *text);
+static GPtrArray *split_words (const gchar *text);
+static void add_words (HdLauncherSearch *search, GQuark id,
+                       const gchar *text);
+static gint cmp_entries (gconstpointer a, gconstpointer b);
+static gint cmp_items (gconstpointer a, gconstpointer b);
+static guint lower_bound (GArray *entries, const gchar *prefix);
+static GHashTable *match_prefix (HdLauncherSearch *search,
+                                 const gchar *prefix);
+static void free_indexed (Indexed *indexed);
+static gchar *get_text (HdLauncherItem *item);
+
+/* Returns @text without accents and case-folded. */
+static gchar *
+fold (const gchar *text)
+{
+  gchar *decomposed, *folded;
+  const gchar *p;
+  GString *bare;
+
+  if (!(decomposed = g_utf8_normalize (text, -1, G_NORMALIZE_NFD)))
+    return g_strdup ("");
+
+  /* Drop the combining marks NFD has split off the letters. */
+  bare = g_string_sized_new (strlen (decomposed));
+  for (p = decomposed; *p; p = g_utf8_next_char (p))
+    {
+      gunichar c = g_utf8_get_char (p);
+      GUnicodeType type = g_unichar_type (c);
+
+      if (type != G_UNICODE_NON_SPACING_MARK
+          && type != G_UNICODE_ENCLOSING_MARK)
+        g_string_append_unichar (bare, c);
+    }
+  g_free (decomposed);
+
+  folded = g_utf8_casefold (bare->str, bare->len);
+  g_string_free (bare, TRUE);
+  return folded;
+}
+
+/* Returns the folded words of @text, which are separated
+ * by anything but letters and digits. */
+static GPtrArray *
+split_words (const gchar *text)
+{
+  GPtrArray *words;
+  gchar *folded;
+  const gchar *p, *start;
+
+  words = g_ptr_array_new ();
+  folded = fold (text);
+  for (p = start = folded; ; p = g_utf8_next_char (p))
+    {
+      if (!*p || !g_unichar_isalnum (g_utf8_get_char (p)))
+        {
+          if (p > start)
+            g_ptr_array_add (words, g_strndup (start, p - start));
+          if (!*p)
+            break;
+          start = g_utf8_next_char (p);
+        }
+    }
+  g_free (folded);
+
+  return words;
+}
+
+/* Adds the words of @text to @search, unsorted. */
+static void
+add_words (HdLauncherSearch *search, GQuark id, const gchar *text)
+{
+  GPtrArray *words;
+  guint i;
+
+  words = split_words (text);
+  for (i = 0; i < words->len; i++)
+    {
+      Entry entry;
+
+      /* @entries takes over the string. */
+      entry.word = g_ptr_array_index (words, i);
+      entry.id = id;
+      g_array_append_val (search->entries, entry);
+    }
+  g_ptr_array_free (words, TRUE);
+}
+
+static gint
+cmp_entries (gconstpointer a, gconstpointer b)
+{
+  return strcmp (((const Entry *)a)->word, ((const Entry *)b)->word);
+}
+
+static gint
+cmp_items (gconstpointer a, gconstpointer b)
+{
+  return g_utf8_collate (
+            hd_launcher_item_get_local_name (HD_LAUNCHER_ITEM (a)),
+            hd_launcher_item_get_local_name (HD_LAUNCHER_ITEM (b)));
+}
+
+/* Returns the index of the first entry not less than @prefix. */
+static guint
+lower_bound (GArray *entries, const gchar *prefix)
+{
+  guint lo, hi;
+
+  lo = 0;
+  hi = entries->len;
+  while (lo < hi)
+    {
+      guint mid = (lo + hi) / 2;
+
+      if (strcmp (g_array_index (entries, Entry, mid).word, prefix) < 0)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  return lo;
+}
+
+/* Returns the set of ids having a word starting with @prefix. */
+static GHashTable *
+match_prefix (HdLauncherSearch *search, const gchar *prefix)
+{
+  GHashTable *ids;
+  gsize len;
+  guint i;
+
+  ids = g_hash_table_new (NULL, NULL);
+  len = strlen (prefix);
+  for (i = lower_bound (search->entries, prefix); i < search->entries->len;
+       i++)
+    {
+      const Entry *entry = &g_array_index (search->entries, Entry, i);
+
+      if (strncmp (entry->word, prefix, len))
+        break;
+      g_hash_table_insert (ids, GUINT_TO_POINTER (entry->id), NULL);
+    }
+
+  return ids;
+}
+
+static void
+free_indexed (Indexed *indexed)
+{
+  g_object_unref (indexed->item);
+  g_free (indexed->text);
+  g_slice_free (Indexed, indexed);
+}
+
+/* Returns the text of @item we are interested in. */
+static gchar *
+get_text (HdLauncherItem *item)
+{
+  const gchar *comment = hd_launcher_item_get_comment (item);
+
+  return g_strjoin ("\n", hd_launcher_item_get_id (item),
+                    hd_launcher_item_get_local_name (item),
+                    comment ? comment : "", NULL);
+}
+
+HdLauncherSearch *
+hd_launcher_search_new (void)
+{
+  HdLauncherSearch *search;
+
+  search = g_slice_new (HdLauncherSearch);
+  search->entries = g_array_new (FALSE, FALSE, sizeof (Entry));
+  search->items = g_hash_table_new_full (NULL, NULL, NULL,
+                                         (GDestroyNotify)free_indexed);
+  return search;
+}
+
+void
+hd_launcher_search_free (HdLauncherSearch *search)
+{
+  guint i;
+
+  for (i = 0; i < search->entries->len; i++)
+    g_free (g_array_index (search->entries, Entry, i).word);
+  g_array_free (search->entries, TRUE);
+  g_hash_table_destroy (search->items);
+  g_slice_free (HdLauncherSearch, search);
+}
+
+/*
+ * Brings @search up to date with @items, the new contents of the
+ * launcher tree.  Only the applications which are new or whose text
+ * has changed are (re)indexed, and the words of the ones which are
+ * gone are removed.
+ */
+void
+hd_launcher_search_update (HdLauncherSearch *search, GList *items)
+{
+  GHashTable *current, *stale;
+  GHashTableIter iter;
+  gpointer key, value;
+  guint i, nold;
+  GList *l;
+
+  current = g_hash_table_new (NULL, NULL);
+  stale = g_hash_table_new (NULL, NULL);
+  nold = search->entries->len;
+
+  for (l = items; l; l = l->next)
+    {
+      HdLauncherItem *item = l->data;
+      Indexed *indexed;
+      GQuark id;
+      gchar *text;
+
+      if (hd_launcher_item_get_item_type (item) != HD_APPLICATION_LAUNCHER)
+        continue;
+
+      id = hd_launcher_item_get_id_quark (item);
+      text = get_text (item);
+      g_hash_table_insert (current, GUINT_TO_POINTER (id), NULL);
+
+      if ((indexed = g_hash_table_lookup (search->items,
+                                          GUINT_TO_POINTER (id))) != NULL)
+        {
+          /* The tree makes new items every time, keep the latest. */
+          g_object_ref (item);
+          g_object_unref (indexed->item);
+          indexed->item = item;
+
+          if (!strcmp (indexed->text, text))
+            {
+              g_free (text);
+              continue;
+            }
+
+          g_hash_table_insert (stale, GUINT_TO_POINTER (id), NULL);
+          g_free (indexed->text);
+        }
+      else
+        {
+          indexed = g_slice_new (Indexed);
+          indexed->item = g_object_ref (item);
+          g_hash_table_insert (search->items, GUINT_TO_POINTER (id),
+                               indexed);
+        }
+
+      indexed->text = text;
+      add_words (search, id, text);
+    }
+
+  /* Forget about the applications which have been removed. */
+  g_hash_table_iter_init (&iter, search->items);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    if (!g_hash_table_lookup_extended (current, key, NULL, NULL))
+      {
+        g_hash_table_insert (stale, key, NULL);
+        g_hash_table_iter_remove (&iter);
+      }
+
+  /* Drop the old words of the stale ones, in one pass. */
+  if (g_hash_table_size (stale) > 0)
+    {
+      guint j;
+
+      for (i = j = 0; i < search->entries->len; i++)
+        {
+          Entry *entry = &g_array_index (search->entries, Entry, i);
+
+          if (i < nold && g_hash_table_lookup_extended (stale,
+                                GUINT_TO_POINTER (entry->id), NULL, NULL))
+            g_free (entry->word);
+          else
+            g_array_index (search->entries, Entry, j++) = *entry;
+        }
+      g_array_set_size (search->entries, j);
+    }
+
+  if (search->entries->len != nold || g_hash_table_size (stale) > 0)
+    g_array_sort (search->entries, cmp_entries);
+
+  g_hash_table_destroy (stale);
+  g_hash_table_destroy (current);
+}
+
+/*
+ * Returns the applications having a word starting with each word
+ * of @query, in alphabetical order, at most @max_results of them.
+ * The items in the list are not referenced.
+ */
+GList *
+hd_launcher_search_query (HdLauncherSearch *search, const gchar *query,
+                          guint max_results)
+{
+  GPtrArray *words;
+  GHashTable *ids;
+  GHashTableIter iter;
+  gpointer key;
+  GList *results;
+  guint i;
+
+  if (!max_results)
+    return NULL;
+
+  ids = NULL;
+  words = split_words (query);
+  for (i = 0; i < words->len; i++)
+    {
+      GHashTable *matches;
+
+      matches = match_prefix (search, g_ptr_array_index (words, i));
+      if (ids)
+        {
+          /* Keep the ones matching all the words so far. */
+          g_hash_table_iter_init (&iter, ids);
+          while (g_hash_table_iter_next (&iter, &key, NULL))
+            if (!g_hash_table_lookup_extended (matches, key, NULL, NULL))
+              g_hash_table_iter_remove (&iter);
+          g_hash_table_destroy (matches);
+        }
+      else
+        ids = matches;
+      g_free (g_ptr_array_index (words, i));
+    }
+  g_ptr_array_free (words, TRUE);
+
+  if (!ids)
+    return NULL;
+
+  results = NULL;
+  g_hash_table_iter_init (&iter, ids);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+      Indexed *indexed = g_hash_table_lookup (search->items, key);
+
+      if (indexed)
+        results = g_list_prepend (results, indexed->item);
+    }
+  g_hash_table_destroy (ids);
+
+  results = g_list_sort (results, cmp_items);
+  if (g_list_length (results) > max_results)
+    {
+      GList *rest = g_list_nth (results, max_results);
+
+      rest->prev->next = NULL;
+      g_list_free (rest);
+    }
+
+  return results;
+}
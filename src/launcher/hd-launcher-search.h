@@ -0,0 +1,47 @@
+/*
+ * This file is part of hildon-desktop
+ *
+ * Copyright (C) 2009 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*
+ * An index of the words in the names, comments and ids of the
+ * launcher's applications, for finding them as the user types.
+ */
+
+#ifndef __HD_LAUNCHER_SEARCH_H__
+#define __HD_LAUNCHER_SEARCH_H__
+
+#include <glib.h>
+#include "hd-launcher-item.h"
+
+G_BEGIN_DECLS
+
+typedef struct _HdLauncherSearch HdLauncherSearch;
+
+HdLauncherSearch *hd_launcher_search_new    (void);
+void              hd_launcher_search_free   (HdLauncherSearch *search);
+void              hd_launcher_search_update (HdLauncherSearch *search,
+                                             GList            *items);
+GList            *hd_launcher_search_query  (HdLauncherSearch *search,
+                                             const gchar      *query,
+                                             guint             max_results);
+
+G_END_DECLS
+
+#endif /* __HD_LAUNCHER_SEARCH_H__ */
@@ -37,6 +37,7 @@
 #include "hd-gtk-style.h"
 #include "tidy/tidy-highlight.h"
 #include "hd-transition.h"
+#include "hd-icon-cache.h"
 
 #define I_(str) (g_intern_static_string ((str)))
 #define HD_PARAM_READWRITE (G_PARAM_READWRITE | \
@@ -48,6 +49,10 @@
 
 #define HD_LAUNCHER_TILE_LONG_PRESS_DUR (1000)
 
+/* How many labels hd_launcher_tile_get_cached_label() keeps track of
+ * at most, which is more than the applications a device has. */
+#define HD_LAUNCHER_TILE_MAX_CACHED_LABELS (256)
+
 struct _HdLauncherTilePrivate
 {
   gchar *icon_name;
@@ -55,7 +60,12 @@ struct _HdLauncherTilePrivate
 
   ClutterActor *icon;
   ClutterActor *label;
+  /* The key of @label in the label cache, and the generation of
+   * the cache it was made in. */
+  gchar *label_key;
+  guint label_generation;
   TidyHighlight *icon_glow;
+  HdIconRequest *icon_request;
   ClutterTimeline *glow_timeline;
 
   ClutterActor *click_area;
@@ -105,6 +115,10 @@ static gboolean hd_launcher_tile_touched (ClutterActor *actor,
                                           ClutterEvent *event,
                                           ClutterActor *tile);
 
+static void hd_launcher_tile_icon_loaded (ClutterTexture *texture,
+                                          gboolean loaded,
+                                          gpointer data);
+
 static void hd_launcher_on_glow_frame(ClutterTimeline *timeline,
                                       gint msecs,
                                       ClutterActor *actor);
@@ -112,6 +126,7 @@ static void hd_launcher_on_glow_frame(ClutterTimeline *timeline,
 static void hd_launcher_tile_allocate (ClutterActor          *self,
                                        const ClutterActorBox *box,
                                        ClutterAllocationFlags flags);
+static void hd_launcher_tile_map (ClutterActor *actor);
 
 G_DEFINE_TYPE (HdLauncherTile, hd_launcher_tile, CLUTTER_TYPE_GROUP);
 
@@ -130,6 +145,7 @@ hd_launcher_tile_class_init (HdLauncherTileClass *klass)
   gobject_class->finalize     = hd_launcher_tile_finalize;
 
   actor_class->allocate = hd_launcher_tile_allocate;
+  actor_class->map      = hd_launcher_tile_map;
 
   pspec = g_param_spec_string ("icon-name",
                                "Icon Name",
@@ -273,6 +289,8 @@ hd_launcher_tile_get_icon (HdLauncherTile *tile)
   return priv->icon;
 }
 
+/* The label is only created when @tile is first mapped,
+ * until then this returns %NULL. */
 ClutterActor *
 hd_launcher_tile_get_label (HdLauncherTile *tile)
 {
@@ -287,7 +305,6 @@ hd_launcher_tile_set_icon_name (HdLauncherTile *tile,
 {
   HdLauncherTilePrivate *priv = HD_LAUNCHER_TILE_GET_PRIVATE (tile);
   GtkIconTheme *icon_theme;
-  GdkPixbuf *pixbuf;
   GtkIconInfo *info = NULL;
   const gchar *fname;
 
@@ -304,6 +321,16 @@ hd_launcher_tile_set_icon_name (HdLauncherTile *tile,
   fname = priv->icon_name;
 
   /* Recreate the icon actor */
+  if (priv->icon_request)
+    {
+      hd_icon_loader_cancel (priv->icon_request);
+      priv->icon_request = NULL;
+    }
+  if (priv->icon_glow)
+    {
+      clutter_actor_destroy (CLUTTER_ACTOR (priv->icon_glow));
+      priv->icon_glow = NULL;
+    }
   if (priv->icon)
     {
       clutter_actor_destroy (priv->icon);
@@ -362,56 +389,45 @@ hd_launcher_tile_set_icon_name (HdLauncherTile *tile,
     }
 
   /* We must expand these images so there is a 1 pixel transparent
-   * border around them, or the glow effect won't work properly. We use
-   * gdk_pixbuf_new_from_file_at_size as the pixbuf pointed to by fname
-   * isn't actually guaranteed to be the correct size.  */
-  pixbuf = gdk_pixbuf_new_from_file_at_size(fname,
-      HD_LAUNCHER_TILE_ICON_REAL_SIZE, HD_LAUNCHER_TILE_ICON_REAL_SIZE, 0);
-
-  if (pixbuf)
-    {
-      gint w = gdk_pixbuf_get_width(pixbuf);
-      gint h = gdk_pixbuf_get_height(pixbuf);
-
-      GdkPixbuf *pixbufb = gdk_pixbuf_new(
-          GDK_COLORSPACE_RGB, TRUE, 8, w+2, h+2);
-
-      gdk_pixbuf_fill(pixbufb, 0);
-      gdk_pixbuf_copy_area(pixbuf, 0, 0, w, h,
-                           pixbufb, 1, 1);
-
-      priv->icon = clutter_texture_new();
-      clutter_texture_set_from_rgb_data(
-          CLUTTER_TEXTURE(priv->icon),
-          gdk_pixbuf_get_pixels(pixbufb),
-          gdk_pixbuf_get_has_alpha(pixbufb),
-          gdk_pixbuf_get_width(pixbufb),
-          gdk_pixbuf_get_height(pixbufb),
-          gdk_pixbuf_get_rowstride(pixbufb),
-          gdk_pixbuf_get_n_channels(pixbufb), 0, 0);
-      g_object_unref(pixbufb);
-    }
-  if (pixbuf)
-    g_object_unref(pixbuf);
-
-  if (!priv->icon)
-  {
-    g_warning ("%s: couldn't create texture for %s\n", __FUNCTION__, fname);
-    g_free (priv->icon_name);
-    priv->icon_name = NULL;
-    return;
-  }
-
+   * border around them, or the glow effect won't work properly.  The
+   * loader uses gdk_pixbuf_new_from_file_at_size() as the pixbuf pointed
+   * to by fname isn't actually guaranteed to be the correct size.  Until
+   * it's loaded the empty texture stands in for the icon. */
+  priv->icon = clutter_texture_new();
+  clutter_actor_set_name (priv->icon, "HdLauncherTile::icon");
   clutter_actor_set_size (priv->icon,
       HD_LAUNCHER_TILE_ICON_SIZE,
       HD_LAUNCHER_TILE_ICON_SIZE);
   clutter_actor_set_position (priv->icon,
       (HD_LAUNCHER_TILE_WIDTH - HD_LAUNCHER_TILE_ICON_SIZE) / 2, 0);
+  clutter_actor_add_child (CLUTTER_ACTOR(tile), priv->icon);
 
-  if (priv->icon_glow)
-    /* free the old one */
-    clutter_actor_destroy (CLUTTER_ACTOR (priv->icon_glow));
+  priv->icon_request = hd_icon_cache_load (CLUTTER_TEXTURE (priv->icon),
+      fname, HD_LAUNCHER_TILE_ICON_REAL_SIZE, 1,
+      hd_launcher_tile_icon_loaded, tile);
+
+  if (info)
+    gtk_icon_info_free(info);
+}
+
+/* Called by the icon cache when the icon of @tile is ready. */
+static void
+hd_launcher_tile_icon_loaded (ClutterTexture *texture, gboolean loaded,
+                              gpointer data)
+{
+  HdLauncherTile *tile = HD_LAUNCHER_TILE (data);
+  HdLauncherTilePrivate *priv = HD_LAUNCHER_TILE_GET_PRIVATE (tile);
 
+  priv->icon_request = NULL;
+  if (!loaded)
+    {
+      g_warning ("%s: couldn't create texture for %s\n", __FUNCTION__,
+                 priv->icon_name);
+      return;
+    }
+
+  /* The highlight takes the texture's contents when it's created,
+   * so we can only make it now. */
   priv->icon_glow = tidy_highlight_new(CLUTTER_TEXTURE(priv->icon));
   clutter_actor_set_size (CLUTTER_ACTOR(priv->icon_glow),
         HD_LAUNCHER_TILE_GLOW_SIZE,
@@ -421,59 +437,159 @@ hd_launcher_tile_set_icon_name (HdLauncherTile *tile,
         (HD_LAUNCHER_TILE_ICON_SIZE - HD_LAUNCHER_TILE_GLOW_SIZE) / 2);
   clutter_actor_add_child (CLUTTER_ACTOR(tile), CLUTTER_ACTOR(priv->icon_glow));
   clutter_actor_lower_bottom(CLUTTER_ACTOR(priv->icon_glow));
-  clutter_actor_add_child (CLUTTER_ACTOR(tile), priv->icon);
 
-  clutter_actor_hide(CLUTTER_ACTOR(priv->icon_glow));
+  if (priv->glow_amount != 0)
+    tidy_highlight_set_amount(priv->icon_glow,
+                              priv->glow_amount * priv->glow_radius);
+  else
+    clutter_actor_hide(CLUTTER_ACTOR(priv->icon_glow));
+}
+
+/* Tiles are thrown away and made again with the same names whenever
+ * the launcher tree or the search results change.  Their labels are
+ * kept here by font and text, with their measured width, and a new tile
+ * takes over a spare label with its Pango layout, rather than building
+ * and measuring one again.  @spare is %NULL while the label is in use
+ * or hasn't been made yet, and @width is negative until it's measured.
+ * The cache is dropped when the fonts change, which is what the
+ * generation is for. */
+typedef struct
+{
+  gfloat width;
+  ClutterActor *spare;
+} HdLauncherTileCachedLabel;
 
-  gtk_icon_info_free(info);
+static GHashTable *label_cache;
+static guint label_cache_generation;
+
+static void
+hd_launcher_tile_free_cached_label (HdLauncherTileCachedLabel *cached)
+{
+  if (cached->spare)
+    {
+      clutter_actor_destroy (cached->spare);
+      g_object_unref (cached->spare);
+    }
+  g_slice_free (HdLauncherTileCachedLabel, cached);
 }
 
-void
-hd_launcher_tile_set_text (HdLauncherTile *tile,
-                           const gchar *text)
+static void
+hd_launcher_tile_clear_label_cache (void)
+{
+  g_hash_table_remove_all (label_cache);
+  label_cache_generation++;
+}
+
+/* Returns the cache entry of @key, creating it if needed. */
+static HdLauncherTileCachedLabel *
+hd_launcher_tile_get_cached_label (const gchar *key)
+{
+  HdLauncherTileCachedLabel *cached;
+
+  if (!label_cache)
+    {
+      ClutterBackend *backend = clutter_get_default_backend ();
+
+      label_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                           (GDestroyNotify)hd_launcher_tile_free_cached_label);
+      g_signal_connect (backend, "font-changed",
+                        G_CALLBACK (hd_launcher_tile_clear_label_cache), NULL);
+      g_signal_connect (backend, "resolution-changed",
+                        G_CALLBACK (hd_launcher_tile_clear_label_cache), NULL);
+    }
+
+  if ((cached = g_hash_table_lookup (label_cache, key)) != NULL)
+    return cached;
+
+  /* Simply start over if it's full, it will be filled again
+   * with the names which are still used. */
+  if (g_hash_table_size (label_cache) >= HD_LAUNCHER_TILE_MAX_CACHED_LABELS)
+    hd_launcher_tile_clear_label_cache ();
+
+  cached = g_slice_new (HdLauncherTileCachedLabel);
+  cached->width = -1;
+  cached->spare = NULL;
+  g_hash_table_insert (label_cache, g_strdup (key), cached);
+  return cached;
+}
+
+/* Takes the label away from @tile, and keeps it for the next tile
+ * with the same text if there isn't one kept already. */
+static void
+hd_launcher_tile_release_label (HdLauncherTile *tile)
+{
+  HdLauncherTilePrivate *priv = HD_LAUNCHER_TILE_GET_PRIVATE (tile);
+  HdLauncherTileCachedLabel *cached;
+
+  cached = priv->label_generation == label_cache_generation
+    ? g_hash_table_lookup (label_cache, priv->label_key) : NULL;
+  if (cached && !cached->spare)
+    {
+      cached->spare = g_object_ref (priv->label);
+      clutter_actor_remove_child (CLUTTER_ACTOR (tile), priv->label);
+    }
+  else
+    clutter_actor_destroy (priv->label);
+
+  priv->label = NULL;
+  g_free (priv->label_key);
+  priv->label_key = NULL;
+}
+
+/* Creates the label of @tile.  This is only done when the tile is
+ * first mapped, as most tiles are never seen in a session. */
+static void
+hd_launcher_tile_create_label (HdLauncherTile *tile)
 {
   ClutterColor text_color = {0xFF, 0xFF, 0xFF, 0xFF};
   HdLauncherTilePrivate *priv = HD_LAUNCHER_TILE_GET_PRIVATE (tile);
+  HdLauncherTileCachedLabel *cached;
   gfloat label_width;
   gfloat label_height, label_width_px;
   gchar *tile_font = NULL;
 
-  if (!text)
-    return;
+  tile_font = hd_transition_get_string("task_nav", "tile_font", "Nokia Sans 15");
+  label_height = HD_LAUNCHER_TILE_HEIGHT - (64 + HILDON_MARGIN_HALF);
 
-  if (priv->text)
+  priv->label_key = g_strdup_printf ("%s\n%s", tile_font, priv->text);
+  cached = hd_launcher_tile_get_cached_label (priv->label_key);
+  priv->label_generation = label_cache_generation;
+  if (cached->spare)
     {
-      g_free (priv->text);
+      /* Its layout is made already, reset what the grid may have
+       * changed while it was shown by another tile. */
+      priv->label = cached->spare;
+      cached->spare = NULL;
+      clutter_actor_set_opacity (priv->label, 255);
+      clutter_actor_remove_clip (priv->label);
     }
-  priv->text = g_strdup (text);
-
-  /* Recreate the label actor */
-  if (priv->label)
+  else
     {
-      clutter_actor_destroy (priv->label);
+      priv->label = clutter_text_new_full (tile_font, priv->text,
+                                           &text_color);
+      g_object_ref_sink (priv->label);
+      clutter_actor_set_name(priv->label, "HdLauncherTile::label");
+
+      /* FIXME: This is a huge work-around because clutter/pango do not
+       * support setting ellipsize to NONE and wrap to FALSE.
+       */
+      clutter_text_set_line_wrap (CLUTTER_TEXT (priv->label), TRUE);
+      clutter_text_set_ellipsize (CLUTTER_TEXT (priv->label),
+                                  PANGO_ELLIPSIZE_NONE);
+      clutter_text_set_line_alignment (CLUTTER_TEXT (priv->label),
+                                       PANGO_ALIGN_CENTER);
+      clutter_text_set_line_wrap_mode (CLUTTER_TEXT (priv->label),
+                                       PANGO_WRAP_CHAR);
+
+      /* Measuring leaves the unconstrained layout in the label, which
+       * it paints with unless it's wider than the tile. */
+      if (cached->width < 0)
+        clutter_actor_get_preferred_width (priv->label, label_height,
+                                           NULL, &cached->width);
     }
-
-  tile_font = hd_transition_get_string("task_nav", "tile_font", "Nokia Sans 15");
-
-  priv->label = clutter_text_new_full (tile_font, priv->text, &text_color);
   g_free (tile_font);
-  clutter_actor_set_name(priv->label, "HdLauncherTile::label");
-
-  /* FIXME: This is a huge work-around because clutter/pango do not
-   * support setting ellipsize to NONE and wrap to FALSE.
-   */
-  clutter_text_set_line_wrap (CLUTTER_TEXT (priv->label), TRUE);
-  clutter_text_set_ellipsize (CLUTTER_TEXT (priv->label),
-                              PANGO_ELLIPSIZE_NONE);
-  clutter_text_set_line_alignment (CLUTTER_TEXT (priv->label),
-                                   PANGO_ALIGN_CENTER);
-  clutter_text_set_line_wrap_mode (CLUTTER_TEXT (priv->label),
-                                   PANGO_WRAP_CHAR);
-
-  label_height = HD_LAUNCHER_TILE_HEIGHT - (64 + HILDON_MARGIN_HALF);
 
-  clutter_actor_get_preferred_width (priv->label, label_height, NULL,
-                                     &label_width);
+  label_width = cached->width;
   label_width_px = MIN (label_width, HD_LAUNCHER_TILE_WIDTH);
 
   clutter_actor_set_size(priv->label, label_width_px, label_height);
@@ -481,12 +597,37 @@ hd_launcher_tile_set_text (HdLauncherTile *tile,
       (HD_LAUNCHER_TILE_WIDTH - label_width_px) / 2,
       HD_LAUNCHER_TILE_HEIGHT - label_height);
   clutter_actor_add_child (CLUTTER_ACTOR(tile), priv->label);
+  g_object_unref (priv->label);
 
   if (label_width > HD_LAUNCHER_TILE_WIDTH)
     clutter_actor_set_clip (priv->label, 0, 0,
                   HD_LAUNCHER_TILE_WIDTH, label_height);
 }
 
+void
+hd_launcher_tile_set_text (HdLauncherTile *tile,
+                           const gchar *text)
+{
+  HdLauncherTilePrivate *priv = HD_LAUNCHER_TILE_GET_PRIVATE (tile);
+
+  if (!text)
+    return;
+
+  if (priv->text)
+    {
+      g_free (priv->text);
+    }
+  priv->text = g_strdup (text);
+
+  /* Recreate the label actor if it's been made already,
+   * otherwise leave it to hd_launcher_tile_map(). */
+  if (priv->label)
+    {
+      hd_launcher_tile_release_label (tile);
+      hd_launcher_tile_create_label (tile);
+    }
+}
+
 static void
 hd_launcher_tile_set_property (GObject      *gobject,
                                guint         prop_id,
@@ -677,6 +818,11 @@ hd_launcher_tile_dispose (GObject *gobject)
       g_source_remove (priv->press_timeout);
       priv->press_timeout = 0;
     }
+  if (priv->icon_request)
+    {
+      hd_icon_loader_cancel (priv->icon_request);
+      priv->icon_request = NULL;
+    }
   if (priv->glow_timeline)
     {
       clutter_timeline_stop(priv->glow_timeline);
@@ -684,10 +830,7 @@ hd_launcher_tile_dispose (GObject *gobject)
       priv->glow_timeline = 0;
     }
   if (priv->label)
-    {
-      clutter_actor_destroy (priv->label);
-      priv->label = 0;
-    }
+    hd_launcher_tile_release_label (HD_LAUNCHER_TILE (gobject));
   if (priv->icon_glow)
     {
       clutter_actor_destroy (CLUTTER_ACTOR(priv->icon_glow));
@@ -708,6 +851,7 @@ hd_launcher_tile_finalize (GObject *gobject)
 
   g_free (priv->icon_name);
   g_free (priv->text);
+  g_free (priv->label_key);
 
   G_OBJECT_CLASS (hd_launcher_tile_parent_class)->finalize (gobject);
 }
@@ -741,6 +885,18 @@ hd_launcher_tile_allocate (ClutterActor          *self,
   actor_class->allocate (self, box, flags);
 }
 
+static void
+hd_launcher_tile_map (ClutterActor *actor)
+{
+  HdLauncherTilePrivate *priv = HD_LAUNCHER_TILE_GET_PRIVATE (actor);
+
+  /* Create the label before chaining up so it's mapped with the rest. */
+  if (!priv->label && priv->text)
+    hd_launcher_tile_create_label (HD_LAUNCHER_TILE (actor));
+
+  CLUTTER_ACTOR_CLASS (hd_launcher_tile_parent_class)->map (actor);
+}
+
 /* Reset this tile to the state it should be in when first shown */
 void hd_launcher_tile_reset(HdLauncherTile *tile, gboolean hard)
 {
@@ -43,6 +43,7 @@
 #include "hd-launcher-grid.h"
 #include "hd-launcher-page.h"
 #include "hd-launcher-editor.h"
+#include "hd-launcher-search.h"
 #include "hd-gtk-utils.h"
 #include "hd-render-manager.h"
 #include "hd-app-mgr.h"
@@ -98,8 +99,17 @@ struct _HdLauncherPrivate
 
   gboolean portraited;
   gboolean is_editor_in_landscape;
+
+  /* What the user has typed so far and where we look it up. */
+  HdLauncherSearch *search;
+  GString *search_query;
 };
 
+/* The key of the search results page in @pages, and how many results
+ * we show at most. */
+#define HD_LAUNCHER_SEARCH_PAGE         "hd-launcher-search"
+#define HD_LAUNCHER_SEARCH_MAX_RESULTS  30
+
 #define HD_LAUNCHER_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), \
                                 HD_TYPE_LAUNCHER, HdLauncherPrivate))
 
@@ -138,8 +148,10 @@ static gboolean hd_launcher_background_touched (HdLauncher *self,
                                                 ClutterEvent *event,
                                                 gpointer *data);
 static gboolean hd_launcher_key_pressed (HdLauncher *self,
-                                                ClutterButtonEvent *event,
+                                                ClutterKeyEvent *event,
                                                 gpointer *data);
+static ClutterActor *hd_launcher_get_search_page (HdLauncher *launcher);
+static void hd_launcher_show_search_results (HdLauncher *launcher);
 static void hd_launcher_populate_tree_starting (HdLauncherTree *tree,
                                                 gpointer data);
 static void hd_launcher_populate_tree_finished (HdLauncherTree *tree,
@@ -219,6 +231,8 @@ hd_launcher_init (HdLauncher *self)
   self->priv = priv = HD_LAUNCHER_GET_PRIVATE (self);
   priv->gconf_client = gconf_client_get_default ();
   g_datalist_init (&priv->pages);
+  priv->search = hd_launcher_search_new ();
+  priv->search_query = g_string_new (NULL);
 }
 
 static void hd_launcher_constructed (GObject *gobject)
@@ -282,6 +296,14 @@ hd_launcher_dispose (GObject *gobject)
 
   g_datalist_clear (&priv->pages);
 
+  if (priv->search)
+    {
+      hd_launcher_search_free (priv->search);
+      priv->search = NULL;
+      g_string_free (priv->search_query, TRUE);
+      priv->search_query = NULL;
+    }
+
   G_OBJECT_CLASS (hd_launcher_parent_class)->dispose (gobject);
 }
 
@@ -683,6 +705,7 @@ hd_launcher_populate_tree_starting (HdLauncherTree *tree, gpointer data)
     }
 
   priv->active_page = NULL;
+  g_string_truncate (priv->search_query, 0);
 
   if (priv->current_traversal)
     {
@@ -849,6 +872,9 @@ hd_launcher_populate_tree_finished (HdLauncherTree *tree, gpointer data)
   tdata->items = g_list_copy(hd_launcher_tree_get_items(tree));
   g_list_foreach (tdata->items, (GFunc)g_object_ref, NULL);
 
+  /* Only what has changed since the last time is reindexed. */
+  hd_launcher_search_update (priv->search, hd_launcher_tree_get_items (tree));
+
   if (priv->current_traversal)
     {
       priv->current_traversal->cancelled = TRUE;
@@ -1276,14 +1302,146 @@ hd_launcher_background_clicked (HdLauncher *self,
   return TRUE;
 }
 
+/* Returns the page for the search results, creating it if necessary. */
+static ClutterActor *
+hd_launcher_get_search_page (HdLauncher *launcher)
+{
+  HdLauncherPrivate *priv = HD_LAUNCHER_GET_PRIVATE (launcher);
+  ClutterActor *page;
+
+  page = g_datalist_get_data (&priv->pages, HD_LAUNCHER_SEARCH_PAGE);
+  if (!page)
+    {
+      page = hd_launcher_page_new ();
+      clutter_actor_hide (page);
+      clutter_actor_add_child (CLUTTER_ACTOR (launcher), page);
+      g_datalist_set_data_full (&priv->pages, HD_LAUNCHER_SEARCH_PAGE, page,
+                                (GDestroyNotify) clutter_actor_destroy);
+    }
+
+  return page;
+}
+
+/* Fills the search page with the applications matching @search_query
+ * and brings it in if it isn't the active page already.  The tiles of
+ * applications which were found for the previous query too are kept,
+ * only moved, so typing doesn't make all the icons and labels again. */
+static void
+hd_launcher_show_search_results (HdLauncher *launcher)
+{
+  HdLauncherPrivate *priv = HD_LAUNCHER_GET_PRIVATE (launcher);
+  ClutterActor *page;
+  HdLauncherGrid *grid;
+  GHashTable *shown;
+  GHashTableIter iter;
+  GList *results, *tiles, *l;
+  gpointer tile;
+
+  page = hd_launcher_get_search_page (launcher);
+  grid = HD_LAUNCHER_GRID (hd_launcher_page_get_grid (HD_LAUNCHER_PAGE (page)));
+
+  shown = g_hash_table_new (NULL, NULL);
+  for (l = hd_launcher_grid_get_tiles (grid); l; l = l->next)
+    g_hash_table_insert (shown,
+                         g_object_get_data (l->data, "HD-launcher-item"),
+                         l->data);
+
+  tiles = NULL;
+  results = hd_launcher_search_query (priv->search, priv->search_query->str,
+                                      HD_LAUNCHER_SEARCH_MAX_RESULTS);
+  for (l = results; l; l = l->next)
+    {
+      HdLauncherItem *item = l->data;
+
+      if ((tile = g_hash_table_lookup (shown, item)) != NULL)
+        g_hash_table_remove (shown, item);
+      else
+        {
+          tile = hd_launcher_tile_new (hd_launcher_item_get_icon_name (item),
+                                       hd_launcher_item_get_local_name (item));
+          g_object_set_data (tile, "HD-launcher-item", item);
+          hd_launcher_page_add_tile (HD_LAUNCHER_PAGE (page), tile);
+          g_signal_connect (tile, "clicked",
+                            G_CALLBACK (hd_launcher_application_tile_clicked),
+                            item);
+          g_signal_connect (tile, "long-clicked",
+                      G_CALLBACK (hd_launcher_application_tile_long_clicked),
+                      item);
+        }
+      tiles = g_list_prepend (tiles, tile);
+    }
+  g_list_free (results);
+
+  /* The ones which don't match anymore */
+  g_hash_table_iter_init (&iter, shown);
+  while (g_hash_table_iter_next (&iter, NULL, &tile))
+    clutter_actor_destroy (tile);
+  g_hash_table_destroy (shown);
+
+  tiles = g_list_reverse (tiles);
+  hd_launcher_grid_set_tile_order (grid, tiles);
+  g_list_free (tiles);
+
+  _hd_launcher_layout_page (0, page, NULL);
+
+  if (priv->active_page != page)
+    {
+      if (priv->active_page)
+        hd_launcher_page_transition (HD_LAUNCHER_PAGE (priv->active_page),
+                                     HD_LAUNCHER_PAGE_TRANSITION_BACK);
+      hd_launcher_page_transition (HD_LAUNCHER_PAGE (page),
+                                   HD_LAUNCHER_PAGE_TRANSITION_IN_SUB);
+      priv->active_page = page;
+      g_signal_emit (launcher, launcher_signals[CAT_LAUNCHED], 0, NULL);
+    }
+}
+
+/* Typing searches for applications, Backspace takes back the last
+ * character, and any other key goes back like before. */
 static gboolean
 hd_launcher_key_pressed (HdLauncher *self,
-                                ClutterButtonEvent *event,
+                                ClutterKeyEvent *event,
                                 gpointer *data)
 {
-//  HdLauncherPrivate *priv = HD_LAUNCHER_GET_PRIVATE (hd_launcher_get ());
+  HdLauncherPrivate *priv = HD_LAUNCHER_GET_PRIVATE (hd_launcher_get ());
+  GString *query = priv->search_query;
+  gunichar c;
 
-  hd_launcher_back_button_clicked();
+  if (!STATE_IS_LAUNCHER (hd_render_manager_get_state ())
+      || !priv->active_page)
+    {
+      hd_launcher_back_button_clicked();
+      return TRUE;
+    }
+
+  /* Start over if the user has left the search page in the meantime. */
+  if (priv->active_page != g_datalist_get_data (&priv->pages,
+                                                HD_LAUNCHER_SEARCH_PAGE))
+    g_string_truncate (query, 0);
+
+  c = clutter_event_get_key_unicode ((ClutterEvent *) event);
+  if (event->keyval == CLUTTER_KEY_BackSpace && query->len > 0)
+    {
+      g_string_truncate (query,
+                         g_utf8_find_prev_char (query->str,
+                                                query->str + query->len)
+                         - query->str);
+      if (query->len > 0)
+        hd_launcher_show_search_results (hd_launcher_get ());
+      else
+        hd_launcher_back_button_clicked();
+    }
+  else if (c && g_unichar_isprint (c)
+           && (query->len > 0 || !g_unichar_isspace (c)))
+    {
+      g_string_append_unichar (query, c);
+      hd_launcher_show_search_results (hd_launcher_get ());
+    }
+  else
+    {
+      g_string_truncate (query, 0);
+      hd_launcher_back_button_clicked();
+    }
 
   return TRUE;
 }
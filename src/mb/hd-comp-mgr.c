@@ -1413,6 +1413,18 @@ hd_comp_mgr_get_client_transient_for (MBWindowManagerClient *c)
     : NULL;
 }
 
+/* The key of the content generation of client actors, which is updated
+ * on every damage, so it's not looked up by its name every time. */
+static GQuark
+content_generation_quark (void)
+{
+  static GQuark quark;
+
+  if (!quark)
+    quark = g_quark_from_static_string ("HD-content-generation");
+  return quark;
+}
+
 static void
 hd_comp_mgr_texture_update_area(HdCompMgr *hmgr,
                                 int x, int y, int width, int height,
@@ -1422,7 +1434,16 @@ hd_comp_mgr_texture_update_area(HdCompMgr *hmgr,
   gboolean blur_update = FALSE;
   ClutterActor *actors_stage;
 
-  if (!actor || !clutter_actor_is_visible(actor) || hmgr == 0)
+  if (!actor || hmgr == 0)
+    return;
+
+  /* Count the damage of the client's actor even if it's not shown,
+   * so whoever shows it later can tell if it has changed. */
+  if ((parent = clutter_actor_get_parent (actor)) != NULL)
+    g_object_set_qdata (G_OBJECT (parent), content_generation_quark (),
+         GUINT_TO_POINTER (hd_comp_mgr_get_content_generation (parent) + 1));
+
+  if (!clutter_actor_is_visible(actor))
     return;
 
   if (hd_dbus_display_is_off)
@@ -1476,10 +1497,37 @@ hd_comp_mgr_texture_update_area(HdCompMgr *hmgr,
   if (blur_update)
     return;
 
+  /* In the task navigator application windows are shown as thumbnails,
+   * which are redrawn no more often than their refresh budget allows,
+   * regardless of how often the applications update themselves. */
+  if (STATE_IS_TASK_NAV (hd_render_manager_get_state ())
+      && hd_task_navigator_window_damaged (hd_task_navigator, actor))
+    return;
+
   /* Update the screen. This function checks for scaling/visibility and
    * chooses the area to update accordingly */
   {
     ClutterGeometry area = {x,y,width, height};
+    MBWMCompMgrClutterClient *cc;
+
+    /* Likewise home applets mustn't keep the home screen repainting
+     * at their own pace, that's what their refresh rate is for. */
+    cc = g_object_get_data (G_OBJECT (clutter_actor_get_parent (actor)),
+                            "HD-MBWMCompMgrClutterClient");
+    if (cc && MB_WM_COMP_MGR_CLIENT (cc)->wm_client
+        && HD_IS_HOME_APPLET (MB_WM_COMP_MGR_CLIENT (cc)->wm_client))
+      hd_util_throttle_damage (clutter_actor_get_parent (actor),
+                  hd_home_applet_get_refresh_rate (
+                      HD_HOME_APPLET (MB_WM_COMP_MGR_CLIENT (cc)->wm_client)));
+
+    /* And a live background is redrawn at a steady pace whatever
+     * rate it's animating at, as it's just the backdrop. */
+    if (cc && MB_WM_COMP_MGR_CLIENT (cc)->wm_client
+        && MB_WM_COMP_MGR_CLIENT (cc)->wm_client->window->live_background)
+      hd_util_throttle_damage (clutter_actor_get_parent (actor),
+                          hd_transition_get_int ("home", "live_bg_frame_rate",
+                                                 0));
+
     hd_util_partial_redraw_if_possible(actor, &area);
   }
 }
@@ -3811,6 +3859,16 @@ void hd_comp_mgr_set_effect_running(HdCompMgr *hmgr, gboolean running)
    * It is called when any transition begins or ends. */
 }
 
+/* Returns how many times the contents of @actor, a client's actor, have
+ * been damaged.  It's only meaningful to compare it with an earlier
+ * value to see whether the client has redrawn anything since. */
+guint
+hd_comp_mgr_get_content_generation (ClutterActor *actor)
+{
+  return GPOINTER_TO_UINT (g_object_get_qdata (G_OBJECT (actor),
+                                               content_generation_quark ()));
+}
+
 /* Return the time since the last window was mapped (in ms). This
  * is used in the _launch dbus call to check that the window we
  * were asked to do a transition for hasn't actually mapped before
@@ -3828,6 +3886,36 @@ gint hd_comp_mgr_time_since_last_map(HdCompMgr *hmgr)
 extern gboolean hd_dbus_display_is_off;
 extern MBWindowManager *hd_mb_wm;
 
+/* Stops tracking the damage of live backgrounds which can't be seen,
+ * because the home screen is covered, the display is off or they are
+ * on a view which can't be panned to, and resumes the ones that can be.
+ * This way a live background keeps the screen redrawing only while
+ * it's on show. */
+static void
+update_live_backgrounds (HdCompMgr *hmgr)
+{
+  HdHome *home = HD_HOME (hmgr->priv->home);
+  MBWindowManagerClient *c;
+  GSList *views, *v;
+  gboolean home_shown;
+
+  home_shown = STATE_NEED_DESKTOP (hd_render_manager_get_state ())
+    && !hd_dbus_display_is_off;
+
+  /* The ones shown on all views */
+  mb_wm_stack_enumerate (MB_WM_COMP_MGR (hmgr)->wm, c)
+    if (c->window->live_background < 0)
+      hd_util_set_damage_tracked (c, home_shown);
+
+  views = hd_home_get_not_visible_views (home);
+  views = g_slist_prepend (views, hd_home_get_current_view (home));
+  for (v = views; v; v = v->next)
+    if ((c = hd_home_view_get_live_bg (HD_HOME_VIEW (v->data))) != NULL)
+      hd_util_set_damage_tracked (c, home_shown
+                               && hd_home_view_is_near (HD_HOME_VIEW (v->data)));
+  g_slist_free (views);
+}
+
 void
 hd_comp_mgr_update_applets_on_current_desktop_property (HdCompMgr *hmgr)
 {
@@ -3888,6 +3976,8 @@ hd_comp_mgr_update_applets_on_current_desktop_property (HdCompMgr *hmgr)
   g_slist_free (views);
 
   mb_wm_util_async_untrap_x_errors ();
+
+  update_live_backgrounds (hmgr);
 }
 
 gboolean
@@ -215,6 +215,7 @@ hd_comp_mgr_client_is_maximized (MBGeometry geom)
 }
 
 gint hd_comp_mgr_time_since_last_map(HdCompMgr *hmgr);
+guint hd_comp_mgr_get_content_generation (ClutterActor *actor);
 
 void hd_comp_mgr_update_applets_on_current_desktop_property (HdCompMgr *hmgr);
 void hd_comp_mgr_unredirect_topmost_client (MBWindowManager *wm,
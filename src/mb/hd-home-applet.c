@@ -25,10 +25,12 @@
 #include "hd-wm.h"
 #include "hd-util.h"
 #include "hd-comp-mgr.h"
+#include "hd-transition.h"
 
 #include <matchbox/theme-engines/mb-wm-theme.h>
 
 #include <gconf/gconf-client.h>
+#include <string.h>
 
 #define OPERATOR_APPLET_ID "_HILDON_OPERATOR_APPLET"
 
@@ -76,6 +78,7 @@ hd_home_applet_destroy (MBWMObject *this)
   HdHomeApplet *applet = HD_HOME_APPLET (this);
 
   free (applet->applet_id);
+  g_free (applet->applet_class);
 }
 
 #include <ctype.h>
@@ -122,6 +125,12 @@ hd_home_applet_init (MBWMObject *this, va_list vap)
   if (applet_id)
     XFree (applet_id);
 
+  /* Applet ids are like "worldclock.desktop-0". */
+  applet_id = strrchr (applet->applet_id, '-');
+  applet->applet_class = applet_id && applet_id != applet->applet_id
+    ? g_strndup (applet->applet_id, applet_id - applet->applet_id)
+    : g_strdup (applet->applet_id);
+
   if (strcmp (OPERATOR_APPLET_ID, applet->applet_id) == 0)
     {
       /* Special case operator applet */
@@ -398,3 +407,12 @@ hd_home_applet_new (MBWindowManager *wm, MBWMClientWindow *win)
   return client;
 }
 
+/* Returns how many times a second @applet may be redrawn at most
+ * according to transitions.ini, or 0 if there is no limit. */
+gint
+hd_home_applet_get_refresh_rate (HdHomeApplet *applet)
+{
+  return hd_transition_get_int ("applet_refresh_rate", applet->applet_class,
+                                hd_transition_get_int ("applet_refresh_rate",
+                                                       "default", 0));
+}
@@ -39,6 +39,9 @@ struct HdHomeApplet
   MBWMClientBase    parent;
 
   char             *applet_id;
+  /* @applet_id without the instance number, which is what the
+   * refresh rate is configured for. */
+  char             *applet_class;
 
   Bool              settings;
   unsigned int      view_id;
@@ -56,4 +59,7 @@ hd_home_applet_new (MBWindowManager *wm, MBWMClientWindow *win);
 int
 hd_home_applet_class_type (void);
 
+gint
+hd_home_applet_get_refresh_rate (HdHomeApplet *applet);
+
 #endif
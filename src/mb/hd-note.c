@@ -55,6 +55,7 @@ static HdAtoms IEProperties[] =
   HD_ATOM_HILDON_INCOMING_EVENT_NOTIFICATION_SUMMARY,
   HD_ATOM_HILDON_INCOMING_EVENT_NOTIFICATION_MESSAGE,
   HD_ATOM_HILDON_INCOMING_EVENT_NOTIFICATION_DESTINATION,
+  HD_ATOM_NOTIFICATION_THREAD,
 };
 
 static char *
@@ -593,3 +594,4 @@ DEFINE_ACCESSOR(2, count);
 DEFINE_ACCESSOR(3, summary);
 DEFINE_ACCESSOR(4, message);
 DEFINE_ACCESSOR(5, destination);
+DEFINE_ACCESSOR(6, thread);
@@ -82,7 +82,7 @@ struct HdNote
 
   /* For IncomingEvent:s: property cache and signal id.
    * The strings in the cache are X-allocated. */
-  char *properties[6];
+  char *properties[7];
   unsigned long   property_changed_cb_id;
 };
 
@@ -99,6 +99,7 @@ const char *hd_note_get_summary (HdNote *self);
 const char *hd_note_get_count (HdNote *self);
 const char *hd_note_get_time (HdNote *self);
 const char *hd_note_get_icon (HdNote *self);
+const char *hd_note_get_thread (HdNote *self);
 
 int hd_note_class_type (void);
 
@@ -119,6 +119,33 @@ tidy_blur_effect_create_textures(ClutterOffscreenEffect *effect,
   self->fb[1] = cogl_offscreen_new_with_texture (self->tex[1]);
 }
 
+/* Makes the intermediate textures of @self fit an offscreen texture
+ * of @tex_width x @tex_height unless they do already. */
+static void
+tidy_blur_effect_set_size (TidyBlurEffect *self,
+                           gfloat tex_width, gfloat tex_height)
+{
+  gfloat blur[2];
+
+  if (self->tex[0] && self->tex_width == tex_width &&
+      self->tex_height == tex_height)
+    return;
+
+  tidy_blur_effect_create_textures(CLUTTER_OFFSCREEN_EFFECT (self),
+                                   tex_width / 2,
+                                   tex_height / 2);
+  self->tex_width = tex_width;
+  self->tex_height = tex_height;
+
+  blur[0] = 1.0f / self->tex_width;
+  blur[1] = 1.0f / self->tex_height;
+
+  cogl_pipeline_set_uniform_float (self->shader_pipeline,
+                                   self->blur_uniform,
+                                   2, /* n_components */
+                                   1, /* count */
+                                   blur);
+}
 
 static gboolean
 tidy_blur_effect_pre_paint (ClutterEffect *effect)
@@ -151,31 +178,10 @@ tidy_blur_effect_pre_paint (ClutterEffect *effect)
       ClutterOffscreenEffect *offscreen_effect =
           CLUTTER_OFFSCREEN_EFFECT (effect);
       CoglHandle texture;
-      gfloat blur[2];
-      gfloat tex_width, tex_height;
 
       texture = clutter_offscreen_effect_get_texture (offscreen_effect);
-      tex_width = cogl_texture_get_width (texture);
-      tex_height = cogl_texture_get_height (texture);
-
-      if (!self->tex[0] || self->tex_width != tex_width ||
-          self->tex_height != tex_height)
-        {
-          tidy_blur_effect_create_textures(offscreen_effect,
-                                                    tex_width / 2,
-                                                    tex_height / 2);
-          self->tex_width = tex_width;
-          self->tex_height = tex_height;
-
-          blur[0] = 1.0f / self->tex_width;
-          blur[1] = 1.0f / self->tex_height;
-
-          cogl_pipeline_set_uniform_float (self->shader_pipeline,
-                                           self->blur_uniform,
-                                           2, /* n_components */
-                                           1, /* count */
-                                           blur);
-        }
+      tidy_blur_effect_set_size (self, cogl_texture_get_width (texture),
+                                 cogl_texture_get_height (texture));
 
       self->texture = texture;
       cogl_pipeline_set_layer_texture (self->pipeline, 0, texture);
@@ -545,6 +551,28 @@ tidy_blur_effect_set_zoom(ClutterEffect *self, gfloat zoom)
     }
 }
 
+/* Allocates the intermediate textures for blurring an offscreen texture
+ * of @width x @height and runs the blur shader once, so it's compiled
+ * before the first blurred frame needs it. */
+void
+tidy_blur_effect_prewarm(ClutterEffect *effect, gfloat width, gfloat height)
+{
+  TidyBlurEffect *self;
+
+  if (!TIDY_IS_BLUR_EFFECT(effect) || width < 2 || height < 2
+      || !clutter_feature_available (CLUTTER_FEATURE_SHADERS_GLSL))
+    return;
+
+  self = TIDY_BLUR_EFFECT(effect);
+  if (self->tex[0] && self->tex_width == width && self->tex_height == height)
+    return;
+
+  tidy_blur_effect_set_size (self, width, height);
+  cogl_pipeline_set_layer_texture (self->shader_pipeline, 0, self->tex[0]);
+  cogl_framebuffer_draw_rectangle (self->fb[1], self->shader_pipeline,
+                                   -1.0, 1.0, 1.0, -1.0);
+}
+
 gfloat
 tidy_blur_effect_get_zoom(ClutterEffect *self)
 {
@@ -22,6 +22,7 @@ void tidy_blur_effect_set_zoom(ClutterEffect *self, gfloat zoom);
 gfloat tidy_blur_effect_get_zoom(ClutterEffect *self);
 void tidy_blur_effect_set_brigtness(ClutterEffect *self, gfloat brigtness);
 gfloat tidy_blur_effect_get_brigtness(ClutterEffect *self);
+void tidy_blur_effect_prewarm(ClutterEffect *self, gfloat width, gfloat height);
 
 G_END_DECLS
 
@@ -448,6 +448,30 @@ tidy_blur_group_stop_progressing(ClutterActor *blur_group)
   /*priv->skip_progress = TRUE;*/
 }
 
+/**
+ * tidy_blur_group_prewarm:
+ *
+ * Prepares the buffers and the shader of blurring while the blur group
+ * is not blurred, so that blurring doesn't have to on its first frame.
+ * The blurred image itself is redrawn every frame, so it can't be.
+ */
+void
+tidy_blur_group_prewarm(ClutterActor *blur_group)
+{
+  TidyBlurGroupPrivate *priv;
+  gfloat width, height;
+
+  if (!TIDY_IS_SANE_BLUR_GROUP(blur_group))
+    return;
+
+  priv = TIDY_BLUR_GROUP(blur_group)->priv;
+  if (!priv->blur_effect)
+    return;
+
+  clutter_actor_get_size(blur_group, &width, &height);
+  tidy_blur_effect_prewarm(priv->blur_effect, width, height);
+}
+
 /**
  * tidy_blur_group_source_buffered:
  *
@@ -29,6 +29,9 @@ struct _TidyCachedGroupPrivate
   gboolean rotated;
 
   gboolean use_alpha; /* whether to use an alpha channel in our textures */
+  /* opacity to draw the cached image with, on top of the actor's own.
+   * Unlike the actor's opacity it isn't baked into the cached image. */
+  guint8 cache_opacity;
 
   /* 0 = render as normal ClutterGroup, 1 = render fully cached image */
   float cache_amount;
@@ -116,7 +119,7 @@ tidy_cached_group_paint (ClutterActor *actor)
 
       priv->tex = cogl_texture_new_with_size(
                 tex_width, tex_height, COGL_TEXTURE_NO_AUTO_MIPMAP,
-                priv->use_alpha ? COGL_PIXEL_FORMAT_RGBA_8888 :
+                priv->use_alpha ? COGL_PIXEL_FORMAT_RGBA_8888_PRE :
                                   COGL_PIXEL_FORMAT_RGB_565);
 #ifdef UPSTREAM_DISABLED
       cogl_texture_set_filters(priv->tex, CGL_NEAREST, CGL_NEAREST);
@@ -151,7 +154,8 @@ tidy_cached_group_paint (ClutterActor *actor)
       }
 
       cogl_color_init_from_4ub(&white, 0xff, 0xff, 0xff, 0xff);
-      cogl_color_init_from_4ub(&bgcol, 0x00, 0x00, 0x00, 0xff);
+      cogl_color_init_from_4ub(&bgcol, 0x00, 0x00, 0x00,
+                               priv->use_alpha ? 0x00 : 0xff);
 
       cogl_clear(&bgcol, COGL_BUFFER_BIT_COLOR);
       cogl_set_source_color (&white);
@@ -166,7 +170,8 @@ tidy_cached_group_paint (ClutterActor *actor)
 
   /* Render what we've blurred to the screen */
   cogl_color_init_from_4ub(&col, 0xff, 0xff, 0xff,
-                      clutter_actor_get_paint_opacity (actor));
+                      clutter_actor_get_paint_opacity (actor)
+                      * priv->cache_opacity / 0xff);
 
   /* if cache_amount isn't 1, we merge the two images by rendering the
    * real one first, then rendering the other one after... */
@@ -182,6 +187,9 @@ tidy_cached_group_paint (ClutterActor *actor)
     }
 
   /* Now we render the image we have... */
+  if (priv->use_alpha)
+    /* ...which is premultiplied, so the colour must be as well. */
+    cogl_color_premultiply (&col);
   cogl_set_source_color (&col);
 
   if (rotate_90)
@@ -206,16 +214,7 @@ tidy_cached_group_paint (ClutterActor *actor)
 static void
 tidy_cached_group_dispose (GObject *gobject)
 {
-  TidyCachedGroup *container = TIDY_CACHED_GROUP(gobject);
-  TidyCachedGroupPrivate *priv = container->priv;
-
-  if (priv->fbo)
-    {
-      cogl_offscreen_unref(priv->fbo);
-      cogl_texture_unref(priv->tex);
-      priv->fbo = 0;
-      priv->tex = 0;
-    }
+  tidy_cached_group_release_cache (CLUTTER_ACTOR (gobject));
 
   G_OBJECT_CLASS (tidy_cached_group_parent_class)->dispose (gobject);
 }
@@ -245,6 +244,7 @@ tidy_cached_group_init (TidyCachedGroup *self)
   priv->cache_amount = 0;
   priv->downsample = TIDY_CACHED_GROUP_DEFAULT_DOWNSAMPLING;
   priv->use_alpha = FALSE;
+  priv->cache_opacity = 0xff;
   priv->source_changed = TRUE;
 
   priv->tex = 0;
@@ -319,3 +319,64 @@ void tidy_cached_group_changed(ClutterActor *cached_group)
 }
 
 
+
+/* Whether the cached image should keep the transparency of the children.
+ * Without it they are rendered on black, which is fine if the group
+ * covers what is behind it anyway. */
+void tidy_cached_group_set_use_alpha(ClutterActor *cached_group,
+                                     gboolean use_alpha)
+{
+  TidyCachedGroupPrivate *priv;
+
+  if (!TIDY_IS_CACHED_GROUP(cached_group))
+    return;
+
+  priv = TIDY_CACHED_GROUP(cached_group)->priv;
+  if (priv->use_alpha != !!use_alpha)
+    {
+      /* The texture has the wrong format now. */
+      tidy_cached_group_release_cache(cached_group);
+      priv->use_alpha = !!use_alpha;
+    }
+}
+
+/* Sets the opacity the cached image is drawn with.  Use this rather than
+ * the actor's opacity while the cache is being animated, as the latter
+ * would also affect the children when the cache is (re)rendered. */
+void tidy_cached_group_set_cache_opacity(ClutterActor *cached_group,
+                                         guint8 opacity)
+{
+  TidyCachedGroupPrivate *priv;
+
+  if (!TIDY_IS_CACHED_GROUP(cached_group))
+    return;
+
+  priv = TIDY_CACHED_GROUP(cached_group)->priv;
+  if (priv->cache_opacity != opacity)
+    {
+      priv->cache_opacity = opacity;
+      if (clutter_actor_is_visible(cached_group))
+        clutter_actor_queue_redraw(cached_group);
+    }
+}
+
+/* Frees the offscreen buffer and texture the group renders into until
+ * they are needed again.  Useful when the cache is only used during
+ * transitions. */
+void tidy_cached_group_release_cache(ClutterActor *cached_group)
+{
+  TidyCachedGroupPrivate *priv;
+
+  if (!TIDY_IS_CACHED_GROUP(cached_group))
+    return;
+
+  priv = TIDY_CACHED_GROUP(cached_group)->priv;
+  if (priv->fbo)
+    {
+      cogl_offscreen_unref(priv->fbo);
+      cogl_texture_unref(priv->tex);
+      priv->fbo = 0;
+      priv->tex = 0;
+    }
+  priv->source_changed = TRUE;
+}
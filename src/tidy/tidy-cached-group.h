@@ -37,6 +37,11 @@ void tidy_cached_group_set_render_cache(ClutterActor *cached_group, float amount
 void tidy_cached_group_set_downsampling_factor(ClutterActor *cached_group,
                                                float downsample);
 void tidy_cached_group_changed(ClutterActor *cached_group);
+void tidy_cached_group_set_use_alpha(ClutterActor *cached_group,
+                                     gboolean use_alpha);
+void tidy_cached_group_set_cache_opacity(ClutterActor *cached_group,
+                                         guint8 opacity);
+void tidy_cached_group_release_cache(ClutterActor *cached_group);
 
 
 G_END_DECLS
@@ -0,0 +1,232 @@
+/*
+ * This file is part of hildon-desktop
+ *
+ * Copyright (C) 2009 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtk/gtk.h>
+
+#include "hd-icon-cache.h"
+#include "hd-transition.h"
+
+/* How much texture memory may the icons we hold on to take
+ * if transitions.ini doesn't say otherwise. */
+#define HD_ICON_CACHE_DEFAULT_KB        1024
+
+/* An icon texture kept in memory.  @key identifies the file it was
+ * loaded from (and how), @link is its place in @Lru.  Icon files
+ * which change in place are not noticed until the entry drops out,
+ * but theme updates are, see theme_changed(). */
+typedef struct
+{
+  gchar *key;
+  CoglHandle texture;
+  gsize bytes;
+  GList *link;
+} CacheEntry;
+
+/* What to do when a texture we couldn't fill right away is loaded. */
+typedef struct
+{
+  ClutterTexture *texture;
+  gchar *key;
+  HdIconCacheFunc func;
+  gpointer user_data;
+
+  /* The loader gives us premultiplied pixels if we let it use
+   * the disk cache. */
+  gboolean premultiplied;
+} PendingLoad;
+
+/* @Entries maps keys to #CacheEntry:s, @Lru has the same entries
+ * with the most recently used at its head, and @Lru_bytes is their
+ * total size.  @Theme_name is part of the keys, @Cache_dir is where
+ * the icons are saved, or %NULL if we can't save them. */
+static GHashTable *Entries;
+static GQueue Lru = G_QUEUE_INIT;
+static gsize Lru_bytes;
+static gchar *Theme_name;
+static gchar *Cache_dir;
+
+static void init_cache (void);
+static void theme_changed (GtkIconTheme *theme, gpointer unused);
+static void free_entry (CacheEntry *entry);
+static void remember (const gchar *key, CoglHandle texture);
+static void free_pending (PendingLoad *pending);
+static void icon_loaded (GdkPixbuf *pixbuf, gpointer data);
+
+static void
+free_entry (CacheEntry *entry)
+{
+  g_queue_delete_link (&Lru, entry->link);
+  Lru_bytes -= entry->bytes;
+  cogl_handle_unref (entry->texture);
+  g_free (entry->key);
+  g_slice_free (CacheEntry, entry);
+}
+
+/* Forget everything if the icon theme changes, because the same name
+ * may mean a different file now.  GtkIconTheme also tells us when
+ * the icons in the theme directories are updated.  The disk cache takes care of itself
+ * since the theme is part of the file names. */
+static void
+theme_changed (GtkIconTheme *theme, gpointer unused)
+{
+  g_hash_table_remove_all (Entries);
+  g_free (Theme_name);
+  g_object_get (gtk_settings_get_default (),
+                "gtk-icon-theme-name", &Theme_name, NULL);
+}
+
+static void
+init_cache (void)
+{
+  Entries = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                   NULL, (GDestroyNotify)free_entry);
+  g_object_get (gtk_settings_get_default (),
+                "gtk-icon-theme-name", &Theme_name, NULL);
+  g_signal_connect (gtk_icon_theme_get_default (), "changed",
+                    G_CALLBACK (theme_changed), NULL);
+
+  Cache_dir = g_build_filename (g_get_home_dir (),
+                                ".cache", "hildon-desktop", "icons", NULL);
+  if (g_mkdir_with_parents (Cache_dir, 0770))
+    {
+      g_warning ("%s: couldn't create %s", __FUNCTION__, Cache_dir);
+      g_free (Cache_dir);
+      Cache_dir = NULL;
+    }
+}
+
+/* Adds @texture to the memory cache, throwing out the least recently
+ * used icons if we're over the budget. */
+static void
+remember (const gchar *key, CoglHandle texture)
+{
+  CacheEntry *entry;
+  gsize budget;
+
+  if (g_hash_table_lookup (Entries, key))
+    return;
+
+  entry = g_slice_new (CacheEntry);
+  entry->key = g_strdup (key);
+  entry->texture = cogl_handle_ref (texture);
+  entry->bytes = 4 * cogl_texture_get_width (texture)
+    * cogl_texture_get_height (texture);
+  g_queue_push_head (&Lru, entry);
+  entry->link = Lru.head;
+  Lru_bytes += entry->bytes;
+  g_hash_table_insert (Entries, entry->key, entry);
+
+  budget = 1024 * hd_transition_get_int ("icons", "memory_cache_kb",
+                                         HD_ICON_CACHE_DEFAULT_KB);
+  while (Lru_bytes > budget && Lru.tail && Lru.tail->data != entry)
+    g_hash_table_remove (Entries, ((CacheEntry *)Lru.tail->data)->key);
+}
+
+static void
+free_pending (PendingLoad *pending)
+{
+  g_object_unref (pending->texture);
+  g_free (pending->key);
+  g_slice_free (PendingLoad, pending);
+}
+
+static void
+icon_loaded (GdkPixbuf *pixbuf, gpointer data)
+{
+  PendingLoad *pending = data;
+  gboolean loaded;
+
+  loaded = pixbuf && hd_icon_loader_pixbuf_to_texture (pending->texture,
+                                                       pixbuf,
+                                                       pending->premultiplied);
+  if (loaded)
+    remember (pending->key,
+              clutter_texture_get_cogl_texture (pending->texture));
+  if (pending->func)
+    pending->func (pending->texture, loaded, pending->user_data);
+}
+
+/*
+ * Fills @texture with the icon file @fname scaled to @size and padded
+ * with @border transparent pixels.  If the icon is in memory it's done
+ * at once, @func is called before returning and the return value is
+ * %NULL.  Otherwise it's loaded from the disk cache or the file itself
+ * in the background, and the returned request can be cancelled with
+ * hd_icon_loader_cancel() until @func is called.  @func may be %NULL.
+ * @texture is referenced until the request is over.
+ */
+HdIconRequest *
+hd_icon_cache_load (ClutterTexture *texture, const gchar *fname,
+                    guint size, guint border,
+                    HdIconCacheFunc func, gpointer user_data)
+{
+  gchar *key, *cache_fname;
+  CacheEntry *entry;
+  PendingLoad *pending;
+  HdIconRequest *req;
+
+  if (!Entries)
+    init_cache ();
+
+  /* The disk cache file is the same for all versions of @fname,
+   * it's up to the loader to see whether it's up to date.  It does
+   * that in its thread, we don't stat() anything here. */
+  key = g_strdup_printf ("%s:%s:%u:%u", Theme_name ? Theme_name : "",
+                         fname, size, border);
+
+  if ((entry = g_hash_table_lookup (Entries, key)) != NULL)
+    {
+      g_queue_unlink (&Lru, entry->link);
+      g_queue_push_head_link (&Lru, entry->link);
+      clutter_texture_set_cogl_texture (texture, entry->texture);
+      g_free (key);
+      if (func)
+        func (texture, TRUE, user_data);
+      return NULL;
+    }
+
+  cache_fname = NULL;
+  if (Cache_dir)
+    {
+      gchar *sum;
+
+      sum = g_compute_checksum_for_string (G_CHECKSUM_MD5, key, -1);
+      cache_fname = g_build_filename (Cache_dir, sum, NULL);
+      g_free (sum);
+    }
+
+  pending = g_slice_new (PendingLoad);
+  pending->texture = g_object_ref (texture);
+  pending->key = key;
+  pending->func = func;
+  pending->user_data = user_data;
+  pending->premultiplied = cache_fname != NULL;
+  req = hd_icon_loader_load_full (fname, size, border, cache_fname,
+                                  icon_loaded, pending,
+                                  (GDestroyNotify)free_pending);
+
+  g_free (cache_fname);
+  return req;
+}
@@ -0,0 +1,52 @@
+/*
+ * This file is part of hildon-desktop
+ *
+ * Copyright (C) 2009 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*
+ * Icon textures shared by the launcher and the task navigator.
+ * Recently used icons are kept in texture memory, and every icon
+ * is also stored on disk already scaled and premultiplied, so
+ * after a restart they only need to be mapped and uploaded.
+ */
+
+#ifndef __HD_ICON_CACHE_H__
+#define __HD_ICON_CACHE_H__
+
+#include <clutter/clutter.h>
+#include "hd-icon-loader.h"
+
+G_BEGIN_DECLS
+
+/* Called when the texture given to hd_icon_cache_load() is filled
+ * in, or it's clear it won't be, in which case @loaded is %FALSE. */
+typedef void (*HdIconCacheFunc) (ClutterTexture *texture,
+                                 gboolean        loaded,
+                                 gpointer        user_data);
+
+HdIconRequest *hd_icon_cache_load (ClutterTexture  *texture,
+                                   const gchar     *fname,
+                                   guint            size,
+                                   guint            border,
+                                   HdIconCacheFunc  func,
+                                   gpointer         user_data);
+
+G_END_DECLS
+
+#endif /* __HD_ICON_CACHE_H__ */
@@ -0,0 +1,484 @@
+/*
+ * This file is part of hildon-desktop
+ *
+ * Copyright (C) 2009 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+
+#include "hd-icon-loader.h"
+#include "hd-transition.h"
+#include "hildon-desktop.h"
+
+/* How many finished requests to hand over to their owners in one go
+ * if transitions.ini doesn't say otherwise. */
+#define HD_ICON_LOADER_DEFAULT_BATCH    4
+
+/* Identifies our cache files, change it whenever the format does. */
+#define HD_ICON_LOADER_CACHE_MAGIC      0x48444931 /* HDI1 */
+
+/* A cache file is this header followed by @height rows of @width
+ * premultiplied RGBA pixels, without padding. */
+typedef struct
+{
+  guint32 magic;
+  guint32 width, height;
+  guint32 size, border;
+  guint64 mtime;
+} CacheHeader;
+
+/* An mmap()ed cache file which a pixbuf's pixels point into. */
+typedef struct
+{
+  gpointer addr;
+  gsize len;
+} CacheMapping;
+
+struct _HdIconRequest
+{
+  gchar *fname;
+  guint size, border;
+
+  /* If @cache_fname is set we try to load the icon from there first,
+   * and store what we decoded there.  @mtime is that of @fname,
+   * looked up by the worker thread. */
+  gchar *cache_fname;
+  time_t mtime;
+
+  /* If set it's called instead of load_pixbuf(). */
+  HdIconLoaderDecodeFunc decode;
+
+  HdIconLoaderFunc func;
+  gpointer user_data;
+  GDestroyNotify destroy;
+
+  /* Set by the worker thread, consumed by the main thread. */
+  GdkPixbuf *pixbuf;
+
+  /* accessed by both threads */
+  volatile gboolean cancelled : 1;
+};
+
+/* The worker thread, requests waiting to be delivered and whether
+ * we have an idle callback scheduled to deliver them.  @Done_queue
+ * and @Drain_scheduled are protected by @Done_lock. */
+static GThreadPool *Worker;
+static GStaticMutex Done_lock = G_STATIC_MUTEX_INIT;
+static GQueue Done_queue = G_QUEUE_INIT;
+static gboolean Drain_scheduled;
+
+static GdkPixbuf *load_pixbuf (const gchar *fname, guint size, guint border);
+static gboolean drain_idle (gpointer unused);
+static void finish_request (HdIconRequest *req);
+static void worker_func (gpointer data, gpointer unused);
+static void submit_request (HdIconRequest *req);
+static void free_request (HdIconRequest *req);
+static void premultiply (GdkPixbuf *pixbuf);
+static GdkPixbuf *load_cached (const HdIconRequest *req);
+static void save_cached (const HdIconRequest *req, GdkPixbuf *pixbuf);
+static void unmap_cached (guchar *pixels, gpointer mapping);
+
+/* Loads @fname scaled to fit in @size x @size, and if @border is
+ * nonzero pads it with that many transparent pixels on all sides.
+ * Runs in the worker thread, so it mustn't touch Clutter or GTK. */
+static GdkPixbuf *
+load_pixbuf (const gchar *fname, guint size, guint border)
+{
+  GError *err;
+  GdkPixbuf *pixbuf, *padded;
+  gint w, h;
+
+  err = NULL;
+  pixbuf = size > 0
+    ? gdk_pixbuf_new_from_file_at_size (fname, size, size, &err)
+    : gdk_pixbuf_new_from_file (fname, &err);
+  if (!pixbuf)
+    {
+      g_warning ("%s: %s", fname, err->message);
+      g_error_free (err);
+      return NULL;
+    }
+
+  if (!border)
+    return pixbuf;
+
+  w = gdk_pixbuf_get_width (pixbuf);
+  h = gdk_pixbuf_get_height (pixbuf);
+  padded = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8,
+                           w + 2*border, h + 2*border);
+  gdk_pixbuf_fill (padded, 0);
+  gdk_pixbuf_copy_area (pixbuf, 0, 0, w, h, padded, border, border);
+  g_object_unref (pixbuf);
+
+  return padded;
+}
+
+/* Turns @pixbuf, which must have an alpha channel, into
+ * premultiplied RGBA in place. */
+static void
+premultiply (GdkPixbuf *pixbuf)
+{
+  guchar *row, *p;
+  guint x, y, w, h, stride;
+
+  w = gdk_pixbuf_get_width (pixbuf);
+  h = gdk_pixbuf_get_height (pixbuf);
+  stride = gdk_pixbuf_get_rowstride (pixbuf);
+  row = gdk_pixbuf_get_pixels (pixbuf);
+  for (y = 0; y < h; y++, row += stride)
+    for (x = 0, p = row; x < w; x++, p += 4)
+      {
+        guint a = p[3];
+
+        p[0] = (p[0] * a + 127) / 255;
+        p[1] = (p[1] * a + 127) / 255;
+        p[2] = (p[2] * a + 127) / 255;
+      }
+}
+
+static void
+unmap_cached (guchar *pixels, gpointer mapping)
+{
+  CacheMapping *map = mapping;
+
+  munmap (map->addr, map->len);
+  g_slice_free (CacheMapping, map);
+}
+
+/* Returns a pixbuf whose pixels are mapped from the cache file
+ * of @req, or %NULL if it doesn't exist or is stale. */
+static GdkPixbuf *
+load_cached (const HdIconRequest *req)
+{
+  int fd;
+  struct stat sbuf;
+  gpointer addr;
+  const CacheHeader *hdr;
+  CacheMapping *map;
+
+  if ((fd = open (req->cache_fname, O_RDONLY)) < 0)
+    return NULL;
+  if (fstat (fd, &sbuf) < 0 || sbuf.st_size < sizeof (*hdr))
+    {
+      close (fd);
+      return NULL;
+    }
+
+  addr = mmap (NULL, sbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (addr == MAP_FAILED)
+    return NULL;
+
+  hdr = addr;
+  if (hdr->magic != HD_ICON_LOADER_CACHE_MAGIC
+      || hdr->mtime != (guint64)req->mtime
+      || hdr->size != req->size || hdr->border != req->border
+      || sbuf.st_size != sizeof (*hdr) + 4 * hdr->width * hdr->height)
+    {
+      munmap (addr, sbuf.st_size);
+      return NULL;
+    }
+
+  map = g_slice_new (CacheMapping);
+  map->addr = addr;
+  map->len = sbuf.st_size;
+  return gdk_pixbuf_new_from_data ((const guchar *)(hdr + 1),
+                                   GDK_COLORSPACE_RGB, TRUE, 8,
+                                   hdr->width, hdr->height, 4 * hdr->width,
+                                   unmap_cached, map);
+}
+
+/* Writes the premultiplied @pixbuf to the cache file of @req.
+ * Failure is not fatal, we'll just decode the icon next time too. */
+static void
+save_cached (const HdIconRequest *req, GdkPixbuf *pixbuf)
+{
+  CacheHeader *hdr;
+  guchar *buf, *dst;
+  const guchar *src;
+  guint y, w, h, stride;
+  gsize len;
+  GError *err;
+
+  w = gdk_pixbuf_get_width (pixbuf);
+  h = gdk_pixbuf_get_height (pixbuf);
+  stride = gdk_pixbuf_get_rowstride (pixbuf);
+
+  len = sizeof (*hdr) + 4 * w * h;
+  buf = g_malloc (len);
+  hdr = (CacheHeader *)buf;
+  hdr->magic = HD_ICON_LOADER_CACHE_MAGIC;
+  hdr->width = w;
+  hdr->height = h;
+  hdr->size = req->size;
+  hdr->border = req->border;
+  hdr->mtime = req->mtime;
+
+  src = gdk_pixbuf_get_pixels (pixbuf);
+  dst = (guchar *)(hdr + 1);
+  for (y = 0; y < h; y++, src += stride, dst += 4 * w)
+    memcpy (dst, src, 4 * w);
+
+  /* This writes a temporary file and renames it, so readers
+   * never see a half-written one. */
+  err = NULL;
+  if (!g_file_set_contents (req->cache_fname, (const gchar *)buf, len, &err))
+    {
+      g_debug ("%s: %s", req->cache_fname, err->message);
+      g_error_free (err);
+    }
+
+  g_free (buf);
+}
+
+static void
+free_request (HdIconRequest *req)
+{
+  if (req->destroy)
+    req->destroy (req->user_data);
+  if (req->pixbuf)
+    g_object_unref (req->pixbuf);
+  g_free (req->fname);
+  g_free (req->cache_fname);
+  g_slice_free (HdIconRequest, req);
+}
+
+/* Hands the finished @req over to the main thread. */
+static void
+finish_request (HdIconRequest *req)
+{
+  g_static_mutex_lock (&Done_lock);
+  g_queue_push_tail (&Done_queue, req);
+  if (!Drain_scheduled)
+    {
+      /* We don't need hd_mutex_enable() since the worker never
+       * touches Clutter, only the main thread does. */
+      Drain_scheduled = TRUE;
+      clutter_threads_add_idle (drain_idle, NULL);
+    }
+  g_static_mutex_unlock (&Done_lock);
+}
+
+static void
+worker_func (gpointer data, gpointer unused)
+{
+  HdIconRequest *req = data;
+
+  if (req->cancelled)
+    goto out;
+
+  if (req->cache_fname)
+    {
+      struct stat sbuf;
+
+      /* This is the only place to tell whether the icon has changed,
+       * so that the main thread doesn't have to stat() every icon it
+       * asks for. */
+      if (stat (req->fname, &sbuf) < 0)
+        {
+          g_warning ("%s: couldn't stat %s", __FUNCTION__, req->fname);
+          goto out;
+        }
+      req->mtime = sbuf.st_mtime;
+
+      if ((req->pixbuf = load_cached (req)) != NULL)
+        goto out;
+    }
+
+  req->pixbuf = req->decode
+    ? req->decode (req->fname, req->user_data)
+    : load_pixbuf (req->fname, req->size, req->border);
+  if (req->pixbuf && req->cache_fname)
+    {
+      if (!gdk_pixbuf_get_has_alpha (req->pixbuf))
+        {
+          GdkPixbuf *tmp;
+
+          tmp = gdk_pixbuf_add_alpha (req->pixbuf, FALSE, 0, 0, 0);
+          g_object_unref (req->pixbuf);
+          req->pixbuf = tmp;
+        }
+      premultiply (req->pixbuf);
+      save_cached (req, req->pixbuf);
+    }
+
+out:
+  finish_request (req);
+}
+
+/* Delivers at most a batch of finished requests, so the texture
+ * uploads done by the callbacks are spread over several main loop
+ * iterations rather than done all at once. */
+static gboolean
+drain_idle (gpointer unused)
+{
+  HdIconRequest *req;
+  gint batch;
+  gboolean more;
+  GQueue todo = G_QUEUE_INIT;
+
+  batch = hd_transition_get_int ("icons", "upload_batch",
+                                 HD_ICON_LOADER_DEFAULT_BATCH);
+  if (batch < 1)
+    batch = 1;
+
+  g_static_mutex_lock (&Done_lock);
+  while (batch-- > 0 && (req = g_queue_pop_head (&Done_queue)) != NULL)
+    g_queue_push_tail (&todo, req);
+  if (!(more = !g_queue_is_empty (&Done_queue)))
+    Drain_scheduled = FALSE;
+  g_static_mutex_unlock (&Done_lock);
+
+  while ((req = g_queue_pop_head (&todo)) != NULL)
+    {
+      if (!req->cancelled)
+        req->func (req->pixbuf, req->user_data);
+      free_request (req);
+    }
+
+  /* Keep going if there is more to do. */
+  return more;
+}
+
+/* Has @req carried out by the worker thread. */
+static void
+submit_request (HdIconRequest *req)
+{
+  if (hd_disable_threads ())
+    worker_func (req, NULL);
+  else
+    {
+      if (!Worker)
+        /* One thread is enough, we're only after not blocking
+         * the main loop. */
+        Worker = g_thread_pool_new (worker_func, NULL, 1, FALSE, NULL);
+      g_thread_pool_push (Worker, req, NULL);
+    }
+}
+
+/* Starts loading @fname, scaled to @size and padded with @border
+ * transparent pixels, and returns a handle to cancel the request
+ * with.  @func is called from the main loop when it's done. */
+HdIconRequest *
+hd_icon_loader_load (const gchar *fname, guint size, guint border,
+                     HdIconLoaderFunc func, gpointer user_data)
+{
+  return hd_icon_loader_load_full (fname, size, border, NULL,
+                                   func, user_data, NULL);
+}
+
+/* Like hd_icon_loader_load(), but if @cache_fname is given the icon
+ * is taken from there unless it's older than @fname, and otherwise
+ * it's written there once decoded.  In this case the pixbuf given
+ * to @func is always premultiplied RGBA.  @destroy is called with
+ * @user_data when the request is freed, whether it was cancelled
+ * or not. */
+HdIconRequest *
+hd_icon_loader_load_full (const gchar *fname, guint size, guint border,
+                          const gchar *cache_fname,
+                          HdIconLoaderFunc func, gpointer user_data,
+                          GDestroyNotify destroy)
+{
+  HdIconRequest *req;
+
+  g_return_val_if_fail (fname != NULL && func != NULL, NULL);
+
+  req = g_slice_new0 (HdIconRequest);
+  req->fname = g_strdup (fname);
+  req->size = size;
+  req->border = border;
+  req->cache_fname = g_strdup (cache_fname);
+  req->func = func;
+  req->user_data = user_data;
+  req->destroy = destroy;
+  submit_request (req);
+
+  return req;
+}
+
+/* Like hd_icon_loader_load() except that @fname is decoded by @decode,
+ * which is called in the worker thread with @user_data.  That's where
+ * you can scale or crop the image other than what icons need.  @destroy
+ * is called with @user_data when the request is freed. */
+HdIconRequest *
+hd_icon_loader_load_with (const gchar *fname, HdIconLoaderDecodeFunc decode,
+                          HdIconLoaderFunc func, gpointer user_data,
+                          GDestroyNotify destroy)
+{
+  HdIconRequest *req;
+
+  g_return_val_if_fail (fname != NULL && decode != NULL && func != NULL,
+                        NULL);
+
+  req = g_slice_new0 (HdIconRequest);
+  req->fname = g_strdup (fname);
+  req->decode = decode;
+  req->func = func;
+  req->user_data = user_data;
+  req->destroy = destroy;
+  submit_request (req);
+
+  return req;
+}
+
+/* Makes sure the callback of @req won't be called.  The request is
+ * freed later by the loader.  It's an error to cancel a request
+ * whose callback has already been called. */
+void
+hd_icon_loader_cancel (HdIconRequest *req)
+{
+  if (req)
+    req->cancelled = TRUE;
+}
+
+/* Uploads @pixbuf into @texture.  Returns whether it succeeded. */
+gboolean
+hd_icon_loader_pixbuf_to_texture (ClutterTexture *texture, GdkPixbuf *pixbuf,
+                                  gboolean premultiplied)
+{
+  GError *err;
+
+  err = NULL;
+  if (!clutter_texture_set_from_rgb_data (texture,
+                                          gdk_pixbuf_get_pixels (pixbuf),
+                                          gdk_pixbuf_get_has_alpha (pixbuf),
+                                          gdk_pixbuf_get_width (pixbuf),
+                                          gdk_pixbuf_get_height (pixbuf),
+                                          gdk_pixbuf_get_rowstride (pixbuf),
+                                          gdk_pixbuf_get_n_channels (pixbuf),
+                                          premultiplied
+                                            ? CLUTTER_TEXTURE_RGB_FLAG_PREMULT
+                                            : 0,
+                                          &err))
+    {
+      g_warning ("clutter_texture_set_from_rgb_data: %s", err->message);
+      g_error_free (err);
+      return FALSE;
+    }
+
+  return TRUE;
+}
@@ -0,0 +1,78 @@
+/*
+ * This file is part of hildon-desktop
+ *
+ * Copyright (C) 2009 Nokia Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*
+ * Loads icon files (and other images) off the main loop.  Decoding
+ * and scaling is done in a worker thread, while the results are handed
+ * back to the main thread a few at a time, so that a burst of requests
+ * (like populating the launcher) doesn't stall the input handling.
+ */
+
+#ifndef __HD_ICON_LOADER_H__
+#define __HD_ICON_LOADER_H__
+
+#include <time.h>
+#include <glib.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <clutter/clutter.h>
+
+G_BEGIN_DECLS
+
+typedef struct _HdIconRequest HdIconRequest;
+
+/* Called in the main thread when the request is finished.  @pixbuf is
+ * %NULL if the file couldn't be loaded, otherwise it is owned by the
+ * loader; take a reference if you need it afterwards.  The request
+ * handle becomes invalid once this returns. */
+typedef void (*HdIconLoaderFunc) (GdkPixbuf *pixbuf, gpointer user_data);
+
+/* Decodes @fname for hd_icon_loader_load_with().  Called in the worker
+ * thread, so it mustn't touch Clutter or GTK, nor the parts of
+ * @user_data the main thread may change meanwhile. */
+typedef GdkPixbuf *(*HdIconLoaderDecodeFunc) (const gchar *fname,
+                                              gpointer     user_data);
+
+HdIconRequest *hd_icon_loader_load (const gchar      *fname,
+                                    guint             size,
+                                    guint             border,
+                                    HdIconLoaderFunc  func,
+                                    gpointer          user_data);
+HdIconRequest *hd_icon_loader_load_full (const gchar      *fname,
+                                         guint             size,
+                                         guint             border,
+                                         const gchar      *cache_fname,
+                                         HdIconLoaderFunc  func,
+                                         gpointer          user_data,
+                                         GDestroyNotify    destroy);
+HdIconRequest *hd_icon_loader_load_with (const gchar            *fname,
+                                         HdIconLoaderDecodeFunc  decode,
+                                         HdIconLoaderFunc        func,
+                                         gpointer                user_data,
+                                         GDestroyNotify          destroy);
+void           hd_icon_loader_cancel (HdIconRequest *req);
+
+gboolean hd_icon_loader_pixbuf_to_texture (ClutterTexture *texture,
+                                           GdkPixbuf      *pixbuf,
+                                           gboolean        premultiplied);
+
+G_END_DECLS
+
+#endif /* __HD_ICON_LOADER_H__ */
@@ -699,6 +699,189 @@ gboolean hd_util_client_obscured(MBWindowManagerClient *client)
 }
 
 
+/* What holds back the damage of a client, kept with its actor.
+ * hd_util_set_damage_tracked() sets @untracked,
+ * hd_util_throttle_damage() sets @throttled until @resume_cb,
+ * @refreshed is when it last let the texture change.  @suspended
+ * is whether the compositor has been told to stop tracking it. */
+typedef struct
+{
+  ClutterActor *actor;
+  gboolean suspended, untracked, throttled;
+  gint64 refreshed;
+  guint resume_cb;
+} DamageState;
+
+static void
+free_damage_state (DamageState *state)
+{
+  if (state->resume_cb)
+    g_source_remove (state->resume_cb);
+  g_slice_free (DamageState, state);
+}
+
+static DamageState *
+get_damage_state (ClutterActor *actor)
+{
+  DamageState *state;
+
+  if (!(state = g_object_get_data (G_OBJECT (actor), "HD-damage-state")))
+    {
+      state = g_slice_new0 (DamageState);
+      state->actor = actor;
+      g_object_set_data_full (G_OBJECT (actor), "HD-damage-state", state,
+                              (GDestroyNotify)free_damage_state);
+    }
+
+  return state;
+}
+
+/* Tells the compositor whether to track the damage of the client
+ * of @state.  When it's resumed the client's textures are brought
+ * up to date, since what it has drawn meanwhile went unnoticed. */
+static void
+update_damage_tracking (DamageState *state)
+{
+  MBWMCompMgrClutterClient *cc;
+  ClutterActor *child;
+  gboolean track;
+  gint i;
+
+  track = !state->untracked && !state->throttled;
+  if (state->suspended == !track)
+    return;
+
+  cc = g_object_get_data (G_OBJECT (state->actor),
+                          "HD-MBWMCompMgrClutterClient");
+  if (!cc)
+    return;
+
+  state->suspended = !track;
+  if (track
+      && (mb_wm_comp_mgr_clutter_client_is_unredirected (
+                                              MB_WM_COMP_MGR_CLIENT (cc))
+          || STATE_IS_NON_COMP (hd_render_manager_get_state ())))
+    /* Whoever redirects it again will track it again. */
+    return;
+
+  mb_wm_comp_mgr_clutter_client_track_damage (cc, track);
+  if (!track)
+    return;
+
+  for (i = 0, child = clutter_actor_get_child_at_index (state->actor, 0);
+       child;
+       child = clutter_actor_get_child_at_index (state->actor, ++i))
+    if (CLUTTER_X11_IS_TEXTURE_PIXMAP (child))
+      {
+        gfloat width, height;
+
+        clutter_actor_get_size (child, &width, &height);
+        clutter_x11_texture_pixmap_update_area (
+                                    CLUTTER_X11_TEXTURE_PIXMAP (child),
+                                    0, 0, width, height);
+      }
+}
+
+static gboolean
+resume_damage_cb (DamageState *state)
+{
+  state->resume_cb = 0;
+  state->throttled = FALSE;
+
+  /* Let the catch-up update through, it counts as the next refresh. */
+  state->refreshed = 0;
+  update_damage_tracking (state);
+
+  return FALSE;
+}
+
+/*
+ * To be called when the texture of @actor, a client's actor, has been
+ * damaged.  If that's sooner than @rate times a second allows, stops
+ * tracking the client's damage for a while, so it can't make the stage
+ * redraw more often than that on average.  The update at hand has been
+ * queued by the texture already, this only keeps the next ones from
+ * following it.  A @rate of 0 means no limit, and lifts the one which
+ * may be in effect, bringing the client's textures up to date.
+ */
+void
+hd_util_throttle_damage (ClutterActor *actor, gint rate)
+{
+  DamageState *state;
+  gint64 now, interval;
+
+  if (rate <= 0)
+    {
+      state = g_object_get_data (G_OBJECT (actor), "HD-damage-state");
+      if (state && state->resume_cb)
+        {
+          g_source_remove (state->resume_cb);
+          resume_damage_cb (state);
+        }
+      return;
+    }
+
+  state = get_damage_state (actor);
+  if (state->throttled)
+    /* Damage that was on its way already. */
+    return;
+
+  now = g_get_monotonic_time ();
+  interval = G_USEC_PER_SEC / rate;
+  if (now >= state->refreshed + interval)
+    {
+      state->refreshed = now;
+      return;
+    }
+
+  /* Two refreshes within an interval, so skip the next one.  When tracking
+   * resumes the client's textures are updated once more, whether or not
+   * it has drawn anything since. */
+  state->throttled = TRUE;
+  state->resume_cb = g_timeout_add ((state->refreshed + 2 * interval - now
+                                     + 999) / 1000,
+                                    (GSourceFunc)resume_damage_cb, state);
+  update_damage_tracking (state);
+}
+
+/* Stops or resumes tracking the damage of @client, for when it can't be
+ * seen anyway.  When it's resumed the client's texture is brought up to
+ * date, since what it has drawn meanwhile went unnoticed.  The state is
+ * kept with the client's actor, so it survives moving the client. */
+void
+hd_util_set_damage_tracked (MBWindowManagerClient *client, gboolean track)
+{
+  ClutterActor *actor;
+  DamageState *state;
+
+  if (!client->cm_client
+      || !(actor = mb_wm_comp_mgr_clutter_client_get_actor (
+                        MB_WM_COMP_MGR_CLUTTER_CLIENT (client->cm_client))))
+    return;
+
+  state = get_damage_state (actor);
+  state->untracked = !track;
+  update_damage_tracking (state);
+}
+
+/* To be called when the damage of @client has been made tracked
+ * behind our back, to stop tracking it again if we should. */
+void
+hd_util_reset_damage_tracking (MBWindowManagerClient *client)
+{
+  ClutterActor *actor;
+  DamageState *state;
+
+  if (!client->cm_client
+      || !(actor = mb_wm_comp_mgr_clutter_client_get_actor (
+                        MB_WM_COMP_MGR_CLUTTER_CLIENT (client->cm_client)))
+      || !(state = g_object_get_data (G_OBJECT (actor), "HD-damage-state")))
+    return;
+
+  state->suspended = FALSE;
+  update_damage_tracking (state);
+}
+
 /* Structure holding a list of keyframes that will be linearly interpolated
  * between to produce animation*/
 struct _HdKeyFrameList {
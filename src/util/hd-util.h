@@ -42,6 +42,11 @@ hd_util_partial_redraw_if_possible(ClutterActor *actor, ClutterGeometry *bounds)
 
 gboolean hd_util_client_obscured(MBWindowManagerClient *client);
 
+void hd_util_throttle_damage (ClutterActor *actor, gint rate);
+void hd_util_set_damage_tracked (MBWindowManagerClient *client,
+                                 gboolean track);
+void hd_util_reset_damage_tracking (MBWindowManagerClient *client);
+
 /* Functions for loading and interpolating from a list of keyframes */
 typedef struct _HdKeyFrameList HdKeyFrameList;
 HdKeyFrameList *hd_key_frame_list_create(const char *keys);
@@ -42,6 +42,7 @@ static gint       start_x;
 static GtkWidget *window = NULL;
 static Atom       pan_atom = None;
 static gint       view_id = 0;
+static gint       update_rate = 0;
 
 #if 0
 static void
@@ -113,6 +114,21 @@ on_button_event (GtkWidget *widget, GdkEventButton *event)
   return FALSE;
 }
 
+/* Redraws the applet like a clock would, only faster, to see how often
+ * the home screen repaints because of it (CLUTTER_SHOW_FPS=1). */
+static gboolean
+update_label (GtkWidget *label)
+{
+  static guint updates;
+  gchar *text;
+
+  text = g_strdup_printf ("%u", ++updates);
+  gtk_label_set_text (GTK_LABEL (label), text);
+  g_free (text);
+
+  return TRUE;
+}
+
 static GdkFilterReturn
 x_event_filter_func (GdkXEvent *xevent, GdkEvent *event, gpointer data)
 {
@@ -147,6 +163,8 @@ int main (int argc, char *argv[])
 
 	  view_id = atoi (argv[i]+10);
 	}
+      else if (!strncmp (argv[i], "--update-rate", 13))
+	update_rate = atoi (argv[i]+14);
     }
 
   gtk_init (&argc, &argv);
@@ -187,6 +205,14 @@ int main (int argc, char *argv[])
   gtk_widget_show (w);
   gtk_box_pack_start (GTK_BOX (b), w, TRUE, TRUE, 0);
 
+  if (update_rate > 0)
+    {
+      w = gtk_label_new ("0");
+      gtk_widget_show (w);
+      gtk_box_pack_start (GTK_BOX (b), w, FALSE, FALSE, 0);
+      g_timeout_add (1000 / update_rate, (GSourceFunc)update_label, w);
+    }
+
   gtk_widget_realize (window);
 
   gdk_window_set_events (window->window,